@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <utility>
+
+#include "rope_vector.hpp"
+
+namespace rvec
+{
+    // algorithm overloads that run their inner loop over each chunk's raw span. the loop
+    // body sees plain pointers and a trip count, so the compiler can vectorize it without
+    // per-element chunk boundary checks.
+
+    template <typename T, std::size_t ChunkSize, typename Allocator, typename F>
+    F for_each(rope_vector<T, ChunkSize, Allocator>& rv, F f)
+    {
+        rv.for_each_chunk([&f](T* data, std::size_t n)
+            {
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    f(data[i]);
+                }
+            });
+        return f;
+    }
+
+    template <typename T, std::size_t ChunkSize, typename Allocator, typename F>
+    F for_each(const rope_vector<T, ChunkSize, Allocator>& rv, F f)
+    {
+        rv.for_each_chunk([&f](const T* data, std::size_t n)
+            {
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    f(data[i]);
+                }
+            });
+        return f;
+    }
+
+    // replaces every element with op(element)
+    template <typename T, std::size_t ChunkSize, typename Allocator, typename UnaryOp>
+    void transform(rope_vector<T, ChunkSize, Allocator>& rv, UnaryOp op)
+    {
+        rv.for_each_chunk([&op](T* data, std::size_t n)
+            {
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    data[i] = op(data[i]);
+                }
+            });
+    }
+
+    // writes op(element) for every element to out
+    template <typename T, std::size_t ChunkSize, typename Allocator, typename OutputIt, typename UnaryOp>
+    OutputIt transform(const rope_vector<T, ChunkSize, Allocator>& rv, OutputIt out, UnaryOp op)
+    {
+        rv.for_each_chunk([&out, &op](const T* data, std::size_t n)
+            {
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    *out++ = op(data[i]);
+                }
+            });
+        return out;
+    }
+
+    template <typename T, std::size_t ChunkSize, typename Allocator, typename Init, typename BinaryOp>
+    Init accumulate(const rope_vector<T, ChunkSize, Allocator>& rv, Init init, BinaryOp op)
+    {
+        rv.for_each_chunk([&init, &op](const T* data, std::size_t n)
+            {
+                // a local accumulator keeps the loop free of stores through a reference
+                Init acc = std::move(init);
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    acc = op(std::move(acc), data[i]);
+                }
+                init = std::move(acc);
+            });
+        return init;
+    }
+
+    template <typename T, std::size_t ChunkSize, typename Allocator, typename Init>
+    Init accumulate(const rope_vector<T, ChunkSize, Allocator>& rv, Init init)
+    {
+        return rvec::accumulate(rv, std::move(init), std::plus<>());
+    }
+
+    template <typename T, std::size_t ChunkSize, typename Allocator, typename Pred>
+    std::size_t count_if(const rope_vector<T, ChunkSize, Allocator>& rv, Pred pred)
+    {
+        std::size_t count = 0;
+        rv.for_each_chunk([&count, &pred](const T* data, std::size_t n)
+            {
+                std::size_t hits = 0;
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    hits += pred(data[i]) ? 1 : 0;
+                }
+                count += hits;
+            });
+        return count;
+    }
+
+    // returns the index of the first element equal to value, or rv.size()
+    template <typename T, std::size_t ChunkSize, typename Allocator, typename U>
+    std::size_t find_index(const rope_vector<T, ChunkSize, Allocator>& rv, const U& value)
+    {
+        std::size_t index = 0;
+        rv.for_each_chunk([&index, &value](const T* data, std::size_t n)
+            {
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    if (data[i] == value)
+                    {
+                        index += i;
+                        return false;
+                    }
+                }
+                index += n;
+                return true;
+            });
+        return index;
+    }
+
+    template <typename T, std::size_t ChunkSize, typename Allocator, typename U>
+    typename rope_vector<T, ChunkSize, Allocator>::iterator find(rope_vector<T, ChunkSize, Allocator>& rv, const U& value)
+    {
+        return rv.begin() + static_cast<std::ptrdiff_t>(rvec::find_index(rv, value));
+    }
+
+    template <typename T, std::size_t ChunkSize, typename Allocator, typename U>
+    typename rope_vector<T, ChunkSize, Allocator>::const_iterator find(const rope_vector<T, ChunkSize, Allocator>& rv, const U& value)
+    {
+        return rv.begin() + static_cast<std::ptrdiff_t>(rvec::find_index(rv, value));
+    }
+
+    template <typename T, std::size_t ChunkSize, typename Allocator, typename OutputIt>
+    OutputIt copy(const rope_vector<T, ChunkSize, Allocator>& rv, OutputIt out)
+    {
+        rv.for_each_chunk([&out](const T* data, std::size_t n)
+            {
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    *out++ = data[i];
+                }
+            });
+        return out;
+    }
+
+    template <typename T, std::size_t ChunkSize, typename Allocator, typename U>
+    void fill(rope_vector<T, ChunkSize, Allocator>& rv, const U& value)
+    {
+        rv.for_each_chunk([&value](T* data, std::size_t n)
+            {
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    data[i] = value;
+                }
+            });
+    }
+} // namespace rvec
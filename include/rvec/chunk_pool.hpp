@@ -0,0 +1,356 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "rope_vector.hpp"
+
+namespace rvec
+{
+
+    struct pool_stats
+    {
+        std::size_t hits = 0; // served from a thread-local magazine
+        std::size_t depot_hits = 0; // served after pulling a full magazine from the depot
+        std::size_t misses = 0; // fell through to operator new
+
+        pool_stats& operator+=(const pool_stats& other)
+        {
+            hits += other.hits;
+            depot_hits += other.depot_hits;
+            misses += other.misses;
+            return *this;
+        }
+    };
+
+    // one thread's counters. only the owning thread writes them, so a bump is a plain load
+    // and store rather than a locked read-modify-write; other threads just read them when
+    // the statistics are asked for.
+    struct stat_counters
+    {
+        std::atomic<std::size_t> hits{ 0 };
+        std::atomic<std::size_t> depot_hits{ 0 };
+        std::atomic<std::size_t> misses{ 0 };
+
+        void bump(std::atomic<std::size_t> stat_counters::* which)
+        {
+            std::atomic<std::size_t>& c = this->*which;
+            c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+
+        pool_stats snapshot() const
+        {
+            pool_stats s;
+            s.hits = hits.load(std::memory_order_relaxed);
+            s.depot_hits = depot_hits.load(std::memory_order_relaxed);
+            s.misses = misses.load(std::memory_order_relaxed);
+            return s;
+        }
+    };
+
+    // the stats() of every chunk_pool size class in use
+    struct pool_registry
+    {
+        std::mutex lock;
+        std::vector<pool_stats (*)()> pools;
+    };
+
+    inline pool_registry& pool_classes()
+    {
+        static pool_registry r;
+        return r;
+    }
+
+    // counters summed over every chunk_pool size class
+    inline pool_stats chunk_pool_stats()
+    {
+        pool_registry& r = pool_classes();
+        std::lock_guard<std::mutex> guard(r.lock);
+        pool_stats s;
+        for (pool_stats (*stats)() : r.pools)
+        {
+            s += stats();
+        }
+        return s;
+    }
+
+    // process-wide slab cache for blocks of one size class. each thread keeps two magazines
+    // (a loaded one and the previous one) so alloc/free pairs stay thread-local; full and empty
+    // magazines are exchanged with a mutex-protected central depot, as in Bonwick's slab
+    // allocator. blocks freed by one thread are reused by the next allocation on any thread.
+    template <std::size_t Bytes, std::size_t Align>
+    class chunk_pool
+    {
+    public:
+        static constexpr std::size_t magazine_capacity = 32;
+        static constexpr std::size_t depot_capacity = 64; // full magazines kept centrally
+
+        static void* allocate()
+        {
+            thread_cache& cache = local();
+            if (cache.loaded->count == 0 && cache.previous->count != 0)
+            {
+                std::swap(cache.loaded, cache.previous);
+            }
+
+            if (cache.loaded->count != 0)
+            {
+                cache.tally.bump(&stat_counters::hits);
+                return cache.loaded->rounds[--cache.loaded->count];
+            }
+
+            if (central().swap_for_full(cache.loaded))
+            {
+                cache.tally.bump(&stat_counters::depot_hits);
+                return cache.loaded->rounds[--cache.loaded->count];
+            }
+
+            cache.tally.bump(&stat_counters::misses);
+            return ::operator new(Bytes, std::align_val_t(Align));
+        }
+
+        static void deallocate(void* p)
+        {
+            thread_cache& cache = local();
+            if (cache.loaded->count == magazine_capacity)
+            {
+                if (cache.previous->count == magazine_capacity)
+                {
+                    central().swap_for_empty(cache.previous);
+                }
+                std::swap(cache.loaded, cache.previous);
+            }
+            cache.loaded->rounds[cache.loaded->count++] = p;
+        }
+
+        // the counters of every live thread plus those of threads that have exited
+        static pool_stats stats()
+        {
+            return central().stats();
+        }
+
+        // frees every block held by the depot; thread-local magazines are left alone
+        static void release()
+        {
+            central().release();
+        }
+
+    private:
+        struct magazine
+        {
+            std::size_t count = 0;
+            void* rounds[magazine_capacity];
+        };
+
+        static void drain(magazine* m)
+        {
+            while (m->count != 0)
+            {
+                ::operator delete(m->rounds[--m->count], Bytes, std::align_val_t(Align));
+            }
+        }
+
+        struct thread_cache;
+
+        struct depot
+        {
+            std::mutex lock;
+            std::vector<magazine*> full;
+            std::vector<magazine*> empty;
+            std::vector<const thread_cache*> threads; // whose counters stats() sums
+            pool_stats retired; // counters of exited threads
+
+            depot()
+            {
+                pool_registry& r = pool_classes();
+                std::lock_guard<std::mutex> guard(r.lock);
+                r.pools.push_back(&chunk_pool::stats);
+            }
+
+            // trades an empty magazine for a full one; false when the depot has none
+            bool swap_for_full(magazine*& m)
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                if (full.empty())
+                {
+                    return false;
+                }
+                empty.push_back(m);
+                m = full.back();
+                full.pop_back();
+                return true;
+            }
+
+            // trades a full magazine for an empty one, freeing its blocks if the depot is full
+            void swap_for_empty(magazine*& m)
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                if (full.size() == depot_capacity)
+                {
+                    drain(m);
+                    return;
+                }
+                full.push_back(m);
+                if (empty.empty())
+                {
+                    m = new magazine;
+                }
+                else
+                {
+                    m = empty.back();
+                    empty.pop_back();
+                }
+            }
+
+            void release()
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                for (magazine* m : full)
+                {
+                    drain(m);
+                    empty.push_back(m);
+                }
+                full.clear();
+            }
+
+            void enter(const thread_cache* t)
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                threads.push_back(t);
+            }
+
+            void leave(const thread_cache* t)
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                retired += t->tally.snapshot();
+                threads.erase(std::find(threads.begin(), threads.end(), t));
+            }
+
+            pool_stats stats()
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                pool_stats s = retired;
+                for (const thread_cache* t : threads)
+                {
+                    s += t->tally.snapshot();
+                }
+                return s;
+            }
+
+            ~depot()
+            {
+                release();
+                for (magazine* m : empty)
+                {
+                    delete m;
+                }
+            }
+        };
+
+        struct thread_cache
+        {
+            magazine* loaded = new magazine;
+            magazine* previous = new magazine;
+            stat_counters tally;
+
+            thread_cache()
+            {
+                central().enter(this);
+            }
+
+            // a retiring thread hands its blocks and its counters back to the depot
+            ~thread_cache()
+            {
+                central().leave(this);
+                for (magazine* m : { loaded, previous })
+                {
+                    if (m->count == magazine_capacity)
+                    {
+                        central().swap_for_empty(m);
+                    }
+                    drain(m);
+                    delete m;
+                }
+            }
+        };
+
+        static depot& central()
+        {
+            static depot d;
+            return d;
+        }
+
+        static thread_cache& local()
+        {
+            thread_local thread_cache cache;
+            return cache;
+        }
+    };
+
+    // stateless allocator that serves single-object requests from the chunk_pool of the
+    // object's size class. rope_vector asks for every chunk and branch as one object, so all
+    // containers of the same (T, ChunkSize) share chunks; array requests go to the heap.
+    template <typename T>
+    class pool_allocator
+    {
+    public:
+        using value_type = T;
+        using is_always_equal = std::true_type;
+
+        pool_allocator() noexcept = default;
+
+        template <typename U>
+        pool_allocator(const pool_allocator<U>&) noexcept
+        {
+        }
+
+        T* allocate(std::size_t n)
+        {
+            if (n == 1)
+            {
+                return static_cast<T*>(chunk_pool<sizeof(T), alignof(T)>::allocate());
+            }
+            return std::allocator<T>().allocate(n);
+        }
+
+        void deallocate(T* p, std::size_t n) noexcept
+        {
+            if (n == 1)
+            {
+                chunk_pool<sizeof(T), alignof(T)>::deallocate(p);
+                return;
+            }
+            std::allocator<T>().deallocate(p, n);
+        }
+
+        // statistics of the pool that serves single T objects
+        static pool_stats stats()
+        {
+            return chunk_pool<sizeof(T), alignof(T)>::stats();
+        }
+
+        template <typename U>
+        bool operator==(const pool_allocator<U>&) const noexcept
+        {
+            return true;
+        }
+
+        template <typename U>
+        bool operator!=(const pool_allocator<U>&) const noexcept
+        {
+            return false;
+        }
+    };
+
+    namespace pooled
+    {
+        // rope_vector whose chunks come from the process-wide chunk_pool
+        template <typename T, std::size_t ChunkSize = 256>
+        using rope_vector = rvec::rope_vector<T, ChunkSize, pool_allocator<T>>;
+    } // namespace pooled
+} // namespace rvec
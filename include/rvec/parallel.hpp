@@ -0,0 +1,740 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__has_include)
+#if __has_include(<execution>)
+#include <execution>
+#endif
+#endif
+
+#include "rope_vector.hpp"
+
+namespace rvec
+{
+    namespace par
+    {
+        // fixed set of worker threads with one task deque each. a worker pops from the back
+        // of its own deque and, when that is empty, steals from the front of the others, so
+        // uneven tasks even out without a central queue. the thread that calls run() works
+        // through the tasks too, which also makes nested run() calls safe.
+        class thread_pool
+        {
+        public:
+            explicit thread_pool(std::size_t threads = default_threads())
+                : queues(threads == 0 ? 1 : threads)
+            {
+                workers.reserve(queues.size());
+                for (std::size_t i = 0; i < queues.size(); ++i)
+                {
+                    workers.emplace_back([this, i]
+                        {
+                            work(i);
+                        });
+                }
+            }
+
+            thread_pool(const thread_pool&) = delete;
+            thread_pool& operator=(const thread_pool&) = delete;
+
+            ~thread_pool()
+            {
+                {
+                    std::lock_guard<std::mutex> guard(sleep_lock);
+                    stopping = true;
+                }
+                wake.notify_all();
+                for (std::thread& t : workers)
+                {
+                    t.join();
+                }
+            }
+
+            // worker threads, not counting callers of run()
+            std::size_t size() const noexcept
+            {
+                return workers.size();
+            }
+
+            // calls body(i) for every i in [0, count) and returns once all calls are done.
+            // the first exception thrown by body is rethrown here; calls not yet started
+            // when it was thrown are skipped.
+            template <typename F>
+            void run(std::size_t count, F&& body)
+            {
+                if (count == 0)
+                {
+                    return;
+                }
+
+                job j;
+                j.body = &body;
+                j.invoke = [](void* b, std::size_t i)
+                    {
+                        (*static_cast<typename std::remove_reference<F>::type*>(b))(i);
+                    };
+                j.remaining.store(count, std::memory_order_relaxed);
+
+                {
+                    // counted before they are queued so that pending never runs negative
+                    std::lock_guard<std::mutex> guard(sleep_lock);
+                    pending += count;
+                }
+                std::size_t start = next_queue.fetch_add(count, std::memory_order_relaxed);
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    queue& q = queues[(start + i) % queues.size()];
+                    std::lock_guard<std::mutex> guard(q.lock);
+                    q.tasks.push_back(task{ &j, i });
+                }
+                wake.notify_all();
+
+                // help out until every task of this job has finished, sleeping while the
+                // last ones run elsewhere
+                task t;
+                while (j.remaining.load(std::memory_order_acquire) != 0)
+                {
+                    if (steal(start, t))
+                    {
+                        execute(t);
+                        continue;
+                    }
+                    std::unique_lock<std::mutex> guard(sleep_lock);
+                    wake.wait(guard, [this, &j]
+                        {
+                            return j.remaining.load(std::memory_order_acquire) == 0 || pending != 0;
+                        });
+                }
+
+                if (j.error)
+                {
+                    std::rethrow_exception(j.error);
+                }
+            }
+
+        private:
+            struct job
+            {
+                void* body = nullptr;
+                void (*invoke)(void*, std::size_t) = nullptr;
+                std::atomic<std::size_t> remaining{ 0 };
+                std::atomic<bool> failed{ false };
+                std::exception_ptr error;
+            };
+
+            struct task
+            {
+                job* owner = nullptr;
+                std::size_t index = 0;
+            };
+
+            struct queue
+            {
+                std::mutex lock;
+                std::deque<task> tasks;
+            };
+
+            static std::size_t default_threads()
+            {
+                std::size_t n = std::thread::hardware_concurrency();
+                return n > 1 ? n - 1 : 1; // the calling thread makes up the last one
+            }
+
+            bool pop(std::size_t self, task& t)
+            {
+                queue& q = queues[self];
+                std::lock_guard<std::mutex> guard(q.lock);
+                if (q.tasks.empty())
+                {
+                    return false;
+                }
+                t = q.tasks.back();
+                q.tasks.pop_back();
+                return true;
+            }
+
+            // takes the oldest task of any queue, starting the scan at first
+            bool steal(std::size_t first, task& t)
+            {
+                for (std::size_t k = 0; k < queues.size(); ++k)
+                {
+                    queue& q = queues[(first + k) % queues.size()];
+                    std::lock_guard<std::mutex> guard(q.lock);
+                    if (!q.tasks.empty())
+                    {
+                        t = q.tasks.front();
+                        q.tasks.pop_front();
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            void execute(const task& t)
+            {
+                {
+                    std::lock_guard<std::mutex> guard(sleep_lock);
+                    --pending;
+                }
+
+                job& j = *t.owner;
+                if (!j.failed.load(std::memory_order_relaxed))
+                {
+                    try
+                    {
+                        j.invoke(j.body, t.index);
+                    }
+                    catch (...)
+                    {
+                        if (!j.failed.exchange(true))
+                        {
+                            j.error = std::current_exception();
+                        }
+                    }
+                }
+                // release pairs with the acquire in run(), publishing the task's writes
+                if (j.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    std::lock_guard<std::mutex> guard(sleep_lock);
+                    wake.notify_all();
+                }
+            }
+
+            void work(std::size_t self)
+            {
+                task t;
+                for (;;)
+                {
+                    if (pop(self, t) || steal(self + 1, t))
+                    {
+                        execute(t);
+                        continue;
+                    }
+
+                    std::unique_lock<std::mutex> guard(sleep_lock);
+                    wake.wait(guard, [this]
+                        {
+                            return stopping || pending != 0;
+                        });
+                    if (stopping && pending == 0)
+                    {
+                        return;
+                    }
+                }
+            }
+
+            std::vector<queue> queues;
+            std::vector<std::thread> workers;
+            std::atomic<std::size_t> next_queue{ 0 }; // where the next job starts queuing
+
+            std::mutex sleep_lock;
+            std::condition_variable wake; // new tasks, a finished job, or shutdown
+            std::size_t pending = 0; // queued tasks not yet picked up
+            bool stopping = false;
+        };
+
+        // the process-wide pool the algorithms below use unless given another
+        inline thread_pool& default_pool()
+        {
+            static thread_pool pool;
+            return pool;
+        }
+
+        namespace detail
+        {
+            // splits [first, last) into ranges whose inner ends fall on chunk seams: each cut
+            // is moved forward to the end of the chunk it lands in, not just of its run, which
+            // stops at the gap of an editing-mode chunk. the ranges are small enough for the
+            // pool to balance them but at least a few chunks long.
+            template <typename T, std::size_t ChunkSize, typename Allocator>
+            std::vector<std::size_t> partition(const rope_vector<T, ChunkSize, Allocator>& rv, std::size_t first, std::size_t last, const thread_pool& pool)
+            {
+                constexpr std::size_t min_grain = 4 * ChunkSize;
+                std::size_t total = last - first;
+                std::size_t parts = std::min(total / min_grain, 4 * (pool.size() + 1));
+
+                std::vector<std::size_t> cuts;
+                cuts.push_back(first);
+                for (std::size_t k = 1; k < parts; ++k)
+                {
+                    std::size_t target = first + total / parts * k;
+                    if (target <= cuts.back())
+                    {
+                        continue;
+                    }
+                    std::size_t cut = rv.chunk_end(target);
+                    if (cut >= last)
+                    {
+                        break;
+                    }
+                    cuts.push_back(cut);
+                }
+                if (total != 0)
+                {
+                    cuts.push_back(last);
+                }
+                return cuts;
+            }
+
+            // calls f(data, n) for each run of [first, last)
+            template <typename Vector, typename F>
+            void walk(Vector& rv, std::size_t first, std::size_t last, F& f)
+            {
+                auto w = rv.runs(first);
+                std::size_t left = last - first;
+                while (left != 0)
+                {
+                    std::size_t n = std::min(static_cast<std::size_t>(w.size()), left);
+                    f(w.data(), n);
+                    left -= n;
+                    if (left != 0)
+                    {
+                        w.advance(n);
+                    }
+                }
+            }
+
+            // op-fold of the elements in [first, last), which must not be empty
+            template <typename Init, typename Vector, typename BinaryOp>
+            Init fold(const Vector& rv, std::size_t first, std::size_t last, BinaryOp& op)
+            {
+                Init acc = *rv.cruns(first).data();
+                auto body = [&acc, &op](const auto* data, std::size_t n)
+                    {
+                        for (std::size_t i = 0; i < n; ++i)
+                        {
+                            acc = op(std::move(acc), data[i]);
+                        }
+                    };
+                detail::walk(rv, first + 1, last, body);
+                return acc;
+            }
+
+            // runs part(begin, end) for every range of the partition of [first, last). a writable
+            // container first copies the chunks it shares, so workers never allocate.
+            template <typename Vector, typename Part>
+            void for_each_range(Vector& rv, std::size_t first, std::size_t last, thread_pool& pool, Part part)
+            {
+                if constexpr (!std::is_const<Vector>::value)
+                {
+                    rv.unshare();
+                }
+                std::vector<std::size_t> cuts = partition(rv, first, last, pool);
+                if (cuts.size() <= 2)
+                {
+                    if (cuts.size() == 2)
+                    {
+                        part(cuts[0], cuts[1]);
+                    }
+                    return;
+                }
+                pool.run(cuts.size() - 1, [&](std::size_t i)
+                    {
+                        part(cuts[i], cuts[i + 1]);
+                    });
+            }
+
+            // init folded with every element of [first, last); op must be associative
+            template <typename Vector, typename Init, typename BinaryOp>
+            Init reduce(const Vector& rv, std::size_t first, std::size_t last, Init init, BinaryOp& op, thread_pool& pool)
+            {
+                std::vector<std::size_t> cuts = partition(rv, first, last, pool);
+                if (cuts.size() < 2)
+                {
+                    return init;
+                }
+
+                std::vector<std::optional<Init>> partial(cuts.size() - 1);
+                auto part = [&](std::size_t i)
+                    {
+                        partial[i].emplace(detail::fold<Init>(rv, cuts[i], cuts[i + 1], op));
+                    };
+                if (partial.size() == 1)
+                {
+                    part(0);
+                }
+                else
+                {
+                    pool.run(partial.size(), part);
+                }
+
+                for (std::optional<Init>& p : partial)
+                {
+                    init = op(std::move(init), std::move(*p));
+                }
+                return init;
+            }
+        } // namespace detail
+
+        // algorithms that split a rope_vector into ranges along chunk seams and process them
+        // on a thread_pool. each worker streams its own chunks, and no two workers write to
+        // the same chunk. the container must not change size while one of these runs.
+
+        template <typename T, std::size_t ChunkSize, typename Allocator, typename F>
+        void for_each(rope_vector<T, ChunkSize, Allocator>& rv, F f, thread_pool& pool = default_pool())
+        {
+            detail::for_each_range(rv, 0, rv.size(), pool, [&](std::size_t first, std::size_t last)
+                {
+                    auto body = [&f](T* data, std::size_t n)
+                        {
+                            for (std::size_t i = 0; i < n; ++i)
+                            {
+                                f(data[i]);
+                            }
+                        };
+                    detail::walk(rv, first, last, body);
+                });
+        }
+
+        template <typename T, std::size_t ChunkSize, typename Allocator, typename F>
+        void for_each(const rope_vector<T, ChunkSize, Allocator>& rv, F f, thread_pool& pool = default_pool())
+        {
+            detail::for_each_range(rv, 0, rv.size(), pool, [&](std::size_t first, std::size_t last)
+                {
+                    auto body = [&f](const T* data, std::size_t n)
+                        {
+                            for (std::size_t i = 0; i < n; ++i)
+                            {
+                                f(data[i]);
+                            }
+                        };
+                    detail::walk(rv, first, last, body);
+                });
+        }
+
+        // replaces every element with op(element)
+        template <typename T, std::size_t ChunkSize, typename Allocator, typename UnaryOp>
+        void transform(rope_vector<T, ChunkSize, Allocator>& rv, UnaryOp op, thread_pool& pool = default_pool())
+        {
+            detail::for_each_range(rv, 0, rv.size(), pool, [&](std::size_t first, std::size_t last)
+                {
+                    auto body = [&op](T* data, std::size_t n)
+                        {
+                            for (std::size_t i = 0; i < n; ++i)
+                            {
+                                data[i] = op(data[i]);
+                            }
+                        };
+                    detail::walk(rv, first, last, body);
+                });
+        }
+
+        // out[i] = op(in[i]); out is resized to in.size(). the ranges follow out's seams, so no
+        // two workers write the same chunk, and each worker walks both containers in lockstep.
+        template <typename T, std::size_t ChunkSize, typename Allocator, typename U, std::size_t OutChunkSize, typename OutAllocator, typename UnaryOp>
+        void transform(const rope_vector<T, ChunkSize, Allocator>& in, rope_vector<U, OutChunkSize, OutAllocator>& out, UnaryOp op, thread_pool& pool = default_pool())
+        {
+            out.resize(in.size());
+            detail::for_each_range(out, 0, out.size(), pool, [&](std::size_t first, std::size_t last)
+                {
+                    auto src = in.cruns(first);
+                    auto dst = out.runs(first);
+                    std::size_t left = last - first;
+                    while (left != 0)
+                    {
+                        std::size_t n = std::min({ static_cast<std::size_t>(src.size()), static_cast<std::size_t>(dst.size()), left });
+                        const T* p = src.data();
+                        U* q = dst.data();
+                        for (std::size_t i = 0; i < n; ++i)
+                        {
+                            q[i] = op(p[i]);
+                        }
+                        left -= n;
+                        if (left != 0)
+                        {
+                            src.advance(n);
+                            dst.advance(n);
+                        }
+                    }
+                });
+        }
+
+        // folds every element into init with op, which must be associative: each range is
+        // reduced on its own and the partial results are combined in order
+        template <typename T, std::size_t ChunkSize, typename Allocator, typename Init, typename BinaryOp>
+        Init reduce(const rope_vector<T, ChunkSize, Allocator>& rv, Init init, BinaryOp op, thread_pool& pool = default_pool())
+        {
+            return detail::reduce(rv, 0, rv.size(), std::move(init), op, pool);
+        }
+
+        template <typename T, std::size_t ChunkSize, typename Allocator>
+        T reduce(const rope_vector<T, ChunkSize, Allocator>& rv, thread_pool& pool = default_pool())
+        {
+            return par::reduce(rv, T(), std::plus<>(), pool);
+        }
+
+        // replaces each element with the op-fold of itself and everything before it. the
+        // ranges are first reduced in parallel, their totals scanned serially, and then each
+        // range is scanned in parallel starting from the total of the ranges before it.
+        template <typename T, std::size_t ChunkSize, typename Allocator, typename BinaryOp>
+        void inclusive_scan(rope_vector<T, ChunkSize, Allocator>& rv, BinaryOp op, thread_pool& pool = default_pool())
+        {
+            rv.unshare();
+            std::vector<std::size_t> cuts = detail::partition(rv, 0, rv.size(), pool);
+            if (cuts.size() < 2)
+            {
+                return;
+            }
+            std::size_t parts = cuts.size() - 1;
+
+            // scans [cuts[i], cuts[i + 1]), seeded with carry unless it is the first range
+            auto scan = [&](std::size_t i, const T* carry)
+                {
+                    T* head = rv.runs(cuts[i]).data();
+                    T acc = carry != nullptr ? op(*carry, *head) : *head;
+                    *head = acc;
+                    auto body = [&acc, &op](T* data, std::size_t n)
+                        {
+                            for (std::size_t j = 0; j < n; ++j)
+                            {
+                                acc = op(std::move(acc), data[j]);
+                                data[j] = acc;
+                            }
+                        };
+                    detail::walk(rv, cuts[i] + 1, cuts[i + 1], body);
+                };
+            if (parts == 1)
+            {
+                scan(0, nullptr);
+                return;
+            }
+
+            // totals of every range but the last, which no later range needs
+            std::vector<std::optional<T>> carry(parts - 1);
+            pool.run(parts - 1, [&](std::size_t i)
+                {
+                    carry[i].emplace(detail::fold<T>(rv, cuts[i], cuts[i + 1], op));
+                });
+            for (std::size_t i = 1; i < carry.size(); ++i)
+            {
+                *carry[i] = op(*carry[i - 1], *carry[i]);
+            }
+
+            pool.run(parts, [&](std::size_t i)
+                {
+                    scan(i, i == 0 ? nullptr : &*carry[i - 1]);
+                });
+        }
+
+        template <typename T, std::size_t ChunkSize, typename Allocator>
+        void inclusive_scan(rope_vector<T, ChunkSize, Allocator>& rv, thread_pool& pool = default_pool())
+        {
+            par::inclusive_scan(rv, std::plus<>(), pool);
+        }
+
+        template <typename T, std::size_t ChunkSize, typename Allocator, typename Pred>
+        std::size_t count_if(const rope_vector<T, ChunkSize, Allocator>& rv, Pred pred, thread_pool& pool = default_pool())
+        {
+            std::atomic<std::size_t> count{ 0 };
+            detail::for_each_range(rv, 0, rv.size(), pool, [&](std::size_t first, std::size_t last)
+                {
+                    std::size_t hits = 0;
+                    auto body = [&hits, &pred](const T* data, std::size_t n)
+                        {
+                            for (std::size_t i = 0; i < n; ++i)
+                            {
+                                hits += pred(data[i]) ? 1 : 0;
+                            }
+                        };
+                    detail::walk(rv, first, last, body);
+                    count.fetch_add(hits, std::memory_order_relaxed);
+                });
+            return count.load(std::memory_order_relaxed);
+        }
+
+        template <typename T, std::size_t ChunkSize, typename Allocator, typename U>
+        void fill(rope_vector<T, ChunkSize, Allocator>& rv, const U& value, thread_pool& pool = default_pool())
+        {
+            detail::for_each_range(rv, 0, rv.size(), pool, [&](std::size_t first, std::size_t last)
+                {
+                    auto body = [&value](T* data, std::size_t n)
+                        {
+                            for (std::size_t i = 0; i < n; ++i)
+                            {
+                                data[i] = value;
+                            }
+                        };
+                    detail::walk(rv, first, last, body);
+                });
+        }
+    } // namespace par
+
+#if defined(__cpp_lib_execution)
+    namespace par
+    {
+        namespace detail
+        {
+            template <typename Policy>
+            struct is_parallel_policy
+                : std::integral_constant<bool, std::is_same<Policy, std::execution::parallel_policy>::value || std::is_same<Policy, std::execution::parallel_unsequenced_policy>::value>
+            {
+            };
+
+            template <typename It, typename = void>
+            struct is_rope_iterator : std::false_type
+            {
+            };
+
+            template <typename It>
+            struct is_rope_iterator<It, std::void_t<decltype(std::declval<It>().container()->runs(std::declval<It>().position()))>> : std::true_type
+            {
+            };
+
+            template <typename Policy, typename It>
+            using enable_for_policy = typename std::enable_if<std::is_execution_policy<Policy>::value && is_rope_iterator<It>::value>::type;
+        } // namespace detail
+    } // namespace par
+
+    // overloads of the standard parallel algorithms for rope_vector iterator ranges. a call
+    // like for_each(std::execution::par_unseq, rv.begin(), rv.end(), f), unqualified or as
+    // rvec::for_each, finds them through the iterator's namespace and splits the range on
+    // chunk seams over the default thread_pool. other policies go to the std algorithm.
+
+    template <typename Policy, typename It, typename F, typename = par::detail::enable_for_policy<Policy, It>>
+    void for_each(const Policy& policy, It first, It last, F f)
+    {
+        if constexpr (par::detail::is_parallel_policy<Policy>::value)
+        {
+            auto& rv = *first.container();
+            par::detail::for_each_range(rv, first.position(), last.position(), par::default_pool(), [&](std::size_t begin, std::size_t end)
+                {
+                    auto body = [&f](auto* data, std::size_t n)
+                        {
+                            for (std::size_t i = 0; i < n; ++i)
+                            {
+                                f(data[i]);
+                            }
+                        };
+                    par::detail::walk(rv, begin, end, body);
+                });
+        }
+        else
+        {
+            std::for_each(policy, first, last, f);
+        }
+    }
+
+    template <typename Policy, typename It, typename OutputIt, typename UnaryOp, typename = par::detail::enable_for_policy<Policy, It>>
+    OutputIt transform(const Policy& policy, It first, It last, OutputIt out, UnaryOp op)
+    {
+        if constexpr (par::detail::is_parallel_policy<Policy>::value && par::detail::is_rope_iterator<OutputIt>::value)
+        {
+            // the ranges follow the written container's seams, so no two tasks write one chunk
+            const auto& in = *first.container();
+            auto& dest = *out.container();
+            std::size_t n = static_cast<std::size_t>(last - first);
+            std::size_t in_base = first.position();
+            std::size_t out_base = out.position();
+            dest.unshare();
+            par::detail::for_each_range(dest, out_base, out_base + n, par::default_pool(), [&](std::size_t begin, std::size_t end)
+                {
+                    auto src = in.cruns(in_base + (begin - out_base));
+                    auto dst = dest.runs(begin);
+                    std::size_t left = end - begin;
+                    while (left != 0)
+                    {
+                        std::size_t step = std::min({ static_cast<std::size_t>(src.size()), static_cast<std::size_t>(dst.size()), left });
+                        auto* p = src.data();
+                        auto* q = dst.data();
+                        for (std::size_t i = 0; i < step; ++i)
+                        {
+                            q[i] = op(p[i]);
+                        }
+                        left -= step;
+                        if (left != 0)
+                        {
+                            src.advance(step);
+                            dst.advance(step);
+                        }
+                    }
+                });
+            return out + (last - first);
+        }
+        else
+        {
+            return std::transform(policy, first, last, out, op);
+        }
+    }
+
+    template <typename Policy, typename It, typename U, typename = par::detail::enable_for_policy<Policy, It>>
+    void fill(const Policy& policy, It first, It last, const U& value)
+    {
+        if constexpr (par::detail::is_parallel_policy<Policy>::value)
+        {
+            rvec::for_each(policy, first, last, [&value](auto& x)
+                {
+                    x = value;
+                });
+        }
+        else
+        {
+            std::fill(policy, first, last, value);
+        }
+    }
+
+    template <typename Policy, typename It, typename Pred, typename = par::detail::enable_for_policy<Policy, It>>
+    typename std::iterator_traits<It>::difference_type count_if(const Policy& policy, It first, It last, Pred pred)
+    {
+        if constexpr (par::detail::is_parallel_policy<Policy>::value)
+        {
+            std::atomic<std::ptrdiff_t> count{ 0 };
+            auto& rv = *first.container();
+            par::detail::for_each_range(rv, first.position(), last.position(), par::default_pool(), [&](std::size_t begin, std::size_t end)
+                {
+                    std::ptrdiff_t hits = 0;
+                    auto body = [&hits, &pred](const auto* data, std::size_t n)
+                        {
+                            for (std::size_t i = 0; i < n; ++i)
+                            {
+                                hits += pred(data[i]) ? 1 : 0;
+                            }
+                        };
+                    par::detail::walk(rv, begin, end, body);
+                    count.fetch_add(hits, std::memory_order_relaxed);
+                });
+            return count.load(std::memory_order_relaxed);
+        }
+        else
+        {
+            return std::count_if(policy, first, last, pred);
+        }
+    }
+
+    template <typename Policy, typename It, typename Init, typename BinaryOp, typename = par::detail::enable_for_policy<Policy, It>>
+    Init reduce(const Policy& policy, It first, It last, Init init, BinaryOp op)
+    {
+        if constexpr (par::detail::is_parallel_policy<Policy>::value)
+        {
+            return par::detail::reduce(*first.container(), first.position(), last.position(), std::move(init), op, par::default_pool());
+        }
+        else
+        {
+            return std::reduce(policy, first, last, std::move(init), op);
+        }
+    }
+
+    template <typename Policy, typename It, typename Init, typename = par::detail::enable_for_policy<Policy, It>>
+    Init reduce(const Policy& policy, It first, It last, Init init)
+    {
+        return rvec::reduce(policy, first, last, std::move(init), std::plus<>());
+    }
+
+    template <typename Policy, typename It, typename = par::detail::enable_for_policy<Policy, It>>
+    typename std::iterator_traits<It>::value_type reduce(const Policy& policy, It first, It last)
+    {
+        return rvec::reduce(policy, first, last, typename std::iterator_traits<It>::value_type(), std::plus<>());
+    }
+#endif
+} // namespace rvec
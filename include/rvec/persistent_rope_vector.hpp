@@ -0,0 +1,924 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace rvec
+{
+
+    // an immutable sequence laid out like rope_vector: a counted B+tree over chunks of up to
+    // ChunkSize elements. set(), insert() and erase() leave the version they are called on
+    // untouched and return a new one that shares every node off the edited path, so an edit
+    // copies one chunk and O(log n) branches. nodes are never written once linked, and their
+    // reference counts are atomic, so any version can be read from any thread without locks.
+    template <typename T, std::size_t ChunkSize = 256, typename Allocator = std::allocator<T>>
+    class persistent_rope_vector
+    {
+    public:
+        using value_type = T;
+        using size_type = std::size_t;
+        using allocator_type = Allocator;
+
+    private:
+        static_assert(ChunkSize > 0, "rvec::persistent_rope_vector needs a non-zero chunk size");
+
+        static constexpr size_type branch_capacity = 16;
+
+        struct node
+        {
+            std::atomic<size_type> refs{ 1 }; // versions and branches linking this node
+        };
+
+        // a chunk is always packed: elements live in slots [0, count)
+        struct chunk : node
+        {
+            T* slots = nullptr;
+            size_type count = 0;
+        };
+
+        // branches have no parent pointer, since one branch can sit in many versions
+        struct branch : node
+        {
+            bool bottom = true; // children are chunks rather than branches
+            size_type size = 0;
+            size_type counts[branch_capacity] = {};
+            node* children[branch_capacity] = {};
+        };
+
+        // the nodes replacing one child after an edit: none (it emptied), one, or two (it split)
+        struct edit
+        {
+            node* first = nullptr;
+            size_type first_count = 0;
+            node* second = nullptr;
+            size_type second_count = 0;
+        };
+
+        using alloc_traits = std::allocator_traits<Allocator>;
+
+        template <typename U>
+        using rebind_alloc = typename alloc_traits::template rebind_alloc<U>;
+
+        template <typename U>
+        using rebind_traits = typename alloc_traits::template rebind_traits<U>;
+
+        static constexpr std::size_t chunk_alignment = alignof(chunk) > alignof(T) ? alignof(chunk) : alignof(T);
+        static constexpr std::size_t chunk_header = (sizeof(chunk) + alignof(T) - 1) / alignof(T) * alignof(T);
+        static constexpr std::size_t chunk_bytes = chunk_header + ChunkSize * sizeof(T);
+
+        struct alignas(chunk_alignment) chunk_storage
+        {
+            unsigned char bytes[chunk_bytes];
+        };
+
+        Allocator alloc;
+        branch* root = nullptr;
+        size_type height = 0; // branch levels above the chunks, 0 when empty
+        size_type total_size = 0;
+
+        static void retain(node* n)
+        {
+            n->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // drops one reference; the last one frees the node and releases its children
+        void release(node* n, bool is_chunk)
+        {
+            if (!n || n->refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            {
+                return;
+            }
+
+            if (is_chunk)
+            {
+                free_chunk(static_cast<chunk*>(n));
+                return;
+            }
+
+            branch* b = static_cast<branch*>(n);
+            for (size_type k = 0; k < b->size; ++k)
+            {
+                release(b->children[k], b->bottom);
+            }
+            free_branch(b);
+        }
+
+        void release(const edit& e, bool is_chunk)
+        {
+            release(e.first, is_chunk);
+            release(e.second, is_chunk);
+        }
+
+        // a chunk of n elements; make(slot, j) constructs element j in place
+        template <typename Make>
+        chunk* make_chunk(size_type n, Make&& make)
+        {
+            rebind_alloc<chunk_storage> storage(alloc);
+            chunk_storage* raw = rebind_traits<chunk_storage>::allocate(storage, 1);
+            chunk* c = ::new (static_cast<void*>(raw)) chunk;
+            c->slots = reinterpret_cast<T*>(raw->bytes + chunk_header);
+            try
+            {
+                for (; c->count < n; ++c->count)
+                {
+                    make(c->slots + c->count, c->count);
+                }
+            }
+            catch (...)
+            {
+                free_chunk(c);
+                throw;
+            }
+            return c;
+        }
+
+        void free_chunk(chunk* c)
+        {
+            for (size_type j = 0; j < c->count; ++j)
+            {
+                alloc_traits::destroy(alloc, c->slots + j);
+            }
+            c->~chunk();
+            rebind_alloc<chunk_storage> storage(alloc);
+            rebind_traits<chunk_storage>::deallocate(storage, reinterpret_cast<chunk_storage*>(c), 1);
+        }
+
+        branch* new_branch(bool bottom)
+        {
+            rebind_alloc<branch> branches(alloc);
+            branch* b = rebind_traits<branch>::allocate(branches, 1);
+            rebind_traits<branch>::construct(branches, b);
+            b->bottom = bottom;
+            return b;
+        }
+
+        void free_branch(branch* b)
+        {
+            rebind_alloc<branch> branches(alloc);
+            rebind_traits<branch>::destroy(branches, b);
+            rebind_traits<branch>::deallocate(branches, b, 1);
+        }
+
+        // copies branch b with its child at slot k replaced by the nodes of r. the copy splits
+        // in two when r adds a child to a full branch; it vanishes when its last child does.
+        // on failure r is released, so the caller never cleans up after a throw.
+        edit rebuild(const branch* b, size_type k, const edit& r)
+        {
+            node* kids[branch_capacity + 1];
+            size_type counts[branch_capacity + 1];
+            bool kept[branch_capacity + 1];
+            size_type m = 0;
+            for (size_type j = 0; j < b->size; ++j)
+            {
+                if (j != k)
+                {
+                    kids[m] = b->children[j];
+                    counts[m] = b->counts[j];
+                    kept[m++] = true;
+                    continue;
+                }
+                if (r.first)
+                {
+                    kids[m] = r.first;
+                    counts[m] = r.first_count;
+                    kept[m++] = false;
+                }
+                if (r.second)
+                {
+                    kids[m] = r.second;
+                    counts[m] = r.second_count;
+                    kept[m++] = false;
+                }
+            }
+            if (m == 0)
+            {
+                return edit{};
+            }
+
+            size_type split = m > branch_capacity ? m / 2 : m;
+            branch* left = nullptr;
+            branch* right = nullptr;
+            try
+            {
+                left = new_branch(b->bottom);
+                if (split < m)
+                {
+                    right = new_branch(b->bottom);
+                }
+            }
+            catch (...)
+            {
+                if (left)
+                {
+                    free_branch(left);
+                }
+                release(r, b->bottom);
+                throw;
+            }
+
+            edit out;
+            out.first = left;
+            out.second = right;
+            for (size_type j = 0; j < m; ++j)
+            {
+                if (kept[j])
+                {
+                    retain(kids[j]);
+                }
+                branch* to = j < split ? left : right;
+                to->children[to->size] = kids[j];
+                to->counts[to->size] = counts[j];
+                ++to->size;
+                (j < split ? out.first_count : out.second_count) += counts[j];
+            }
+            return out;
+        }
+
+        // walks down to element i and rebuilds the path bottom-up around what leaf(c, offset)
+        // makes of the chunk found there. i == size() reaches the end of the last chunk.
+        template <typename Leaf>
+        edit descend(const branch* b, size_type i, Leaf& leaf)
+        {
+            size_type k = 0;
+            while (k + 1 < b->size && i >= b->counts[k])
+            {
+                i -= b->counts[k];
+                ++k;
+            }
+
+            edit r = b->bottom ? leaf(*this, static_cast<const chunk*>(b->children[k]), i) : descend(static_cast<const branch*>(b->children[k]), i, leaf);
+            return rebuild(b, k, r);
+        }
+
+        // takes the root edit r as this version's tree, growing or collapsing it as needed
+        void adopt(const edit& r, size_type n)
+        {
+            root = static_cast<branch*>(r.first);
+            total_size = root ? n : 0;
+            if (!root)
+            {
+                height = 0;
+                return;
+            }
+            if (r.second)
+            {
+                branch* top;
+                try
+                {
+                    top = new_branch(false);
+                }
+                catch (...)
+                {
+                    release(r.second, false);
+                    throw;
+                }
+                top->children[0] = r.first;
+                top->counts[0] = r.first_count;
+                top->children[1] = r.second;
+                top->counts[1] = r.second_count;
+                top->size = 2;
+                root = top;
+                ++height;
+            }
+
+            // erases can leave a chain of single-child branches at the top
+            while (height > 1 && root->size == 1)
+            {
+                branch* only = static_cast<branch*>(root->children[0]);
+                retain(only);
+                release(root, false);
+                root = only;
+                --height;
+            }
+        }
+
+        // the version made by rebuilding the path to element i around leaf(out, c, offset),
+        // which returns what becomes of the chunk c found there; out is the new version
+        template <typename Leaf>
+        persistent_rope_vector edited(size_type i, size_type n, Leaf leaf) const
+        {
+            persistent_rope_vector out(alloc);
+            out.height = height;
+            out.adopt(out.descend(root, i, leaf), n);
+            return out;
+        }
+
+        template <typename V>
+        persistent_rope_vector inserted(size_type pos, V&& value) const
+        {
+            assert(pos <= total_size && "insert position out of bounds");
+            if (!root)
+            {
+                persistent_rope_vector out(alloc);
+                chunk* c = out.make_chunk(1, [&](T* p, size_type)
+                    {
+                        alloc_traits::construct(out.alloc, p, std::forward<V>(value));
+                    });
+                out.adopt(out.wrap(c), 1);
+                return out;
+            }
+
+            return edited(pos, total_size + 1, [&value](persistent_rope_vector& out, const chunk* c, size_type offset)
+                {
+                    auto put = [&](T* p, size_type j)
+                        {
+                            if (j == offset)
+                            {
+                                alloc_traits::construct(out.alloc, p, std::forward<V>(value));
+                            }
+                            else
+                            {
+                                alloc_traits::construct(out.alloc, p, c->slots[j < offset ? j : j - 1]);
+                            }
+                        };
+
+                    size_type n = c->count + 1;
+                    if (n <= ChunkSize)
+                    {
+                        return edit{ out.make_chunk(n, put), n };
+                    }
+
+                    // a full chunk splits evenly around the new element
+                    size_type keep = n / 2;
+                    chunk* left = out.make_chunk(keep, put);
+                    chunk* right;
+                    try
+                    {
+                        right = out.make_chunk(n - keep, [&](T* p, size_type j)
+                            {
+                                put(p, keep + j);
+                            });
+                    }
+                    catch (...)
+                    {
+                        out.free_chunk(left);
+                        throw;
+                    }
+                    return edit{ left, keep, right, n - keep };
+                });
+        }
+
+        // a one-chunk tree
+        edit wrap(chunk* c)
+        {
+            branch* b;
+            try
+            {
+                b = new_branch(true);
+            }
+            catch (...)
+            {
+                free_chunk(c);
+                throw;
+            }
+            b->children[0] = c;
+            b->counts[0] = c->count;
+            b->size = 1;
+            height = 1;
+            return edit{ b, c->count };
+        }
+
+        // finds the chunk holding element i (i < size()) and the offset inside it
+        const chunk* locate(size_type& i) const
+        {
+            const branch* b = root;
+            for (;;)
+            {
+                size_type k = 0;
+                while (i >= b->counts[k])
+                {
+                    i -= b->counts[k];
+                    ++k;
+                }
+
+                if (b->bottom)
+                {
+                    return static_cast<const chunk*>(b->children[k]);
+                }
+                b = static_cast<const branch*>(b->children[k]);
+            }
+        }
+
+        // packs [first, last) into full chunks and bulk-loads a tree over them
+        template <typename InputIt>
+        void build(InputIt first, InputIt last)
+        {
+            std::vector<node*> level;
+            std::vector<size_type> counts;
+            std::vector<node*> parents; // the level being built; its branches do not own yet
+            std::vector<size_type> parent_counts;
+            bool bottom = true;
+            try
+            {
+                while (first != last)
+                {
+                    level.push_back(nullptr);
+                    chunk* c = make_chunk(0, [](T*, size_type) {});
+                    level.back() = c;
+                    for (; first != last && c->count < ChunkSize; ++first, ++c->count)
+                    {
+                        alloc_traits::construct(alloc, c->slots + c->count, *first);
+                    }
+                    counts.push_back(c->count);
+                    total_size += c->count;
+                }
+
+                while (level.size() > 1 || (bottom && level.size() == 1))
+                {
+                    parents.reserve((level.size() + branch_capacity - 1) / branch_capacity);
+                    parent_counts.reserve(parents.capacity());
+                    for (size_type k = 0; k < level.size(); k += branch_capacity)
+                    {
+                        branch* b = new_branch(bottom);
+                        parents.push_back(b);
+                        size_type sum = 0;
+                        for (size_type j = k; j < level.size() && j < k + branch_capacity; ++j)
+                        {
+                            b->children[b->size] = level[j];
+                            b->counts[b->size] = counts[j];
+                            ++b->size;
+                            sum += counts[j];
+                        }
+                        parent_counts.push_back(sum);
+                    }
+                    level.swap(parents);
+                    counts.swap(parent_counts);
+                    parents.clear();
+                    parent_counts.clear();
+                    bottom = false;
+                    ++height;
+                }
+            }
+            catch (...)
+            {
+                for (node* b : parents)
+                {
+                    free_branch(static_cast<branch*>(b));
+                }
+                for (node* n : level)
+                {
+                    release(n, bottom);
+                }
+                total_size = 0;
+                height = 0;
+                throw;
+            }
+
+            root = level.empty() ? nullptr : static_cast<branch*>(level[0]);
+        }
+
+    public:
+        persistent_rope_vector() = default;
+
+        explicit persistent_rope_vector(const Allocator& allocator)
+            : alloc(allocator)
+        {
+        }
+
+        template <typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+        persistent_rope_vector(InputIt first, InputIt last, const Allocator& allocator = Allocator())
+            : alloc(allocator)
+        {
+            build(first, last);
+        }
+
+        persistent_rope_vector(std::initializer_list<T> values, const Allocator& allocator = Allocator())
+            : alloc(allocator)
+        {
+            build(values.begin(), values.end());
+        }
+
+        // versions share their whole tree, so copying one is O(1)
+        persistent_rope_vector(const persistent_rope_vector& other)
+            : alloc(other.alloc), root(other.root), height(other.height), total_size(other.total_size)
+        {
+            if (root)
+            {
+                retain(root);
+            }
+        }
+
+        persistent_rope_vector(persistent_rope_vector&& other) noexcept
+            : alloc(std::move(other.alloc)), root(other.root), height(other.height), total_size(other.total_size)
+        {
+            other.root = nullptr;
+            other.height = 0;
+            other.total_size = 0;
+        }
+
+        persistent_rope_vector& operator=(persistent_rope_vector other) noexcept
+        {
+            swap(other);
+            return *this;
+        }
+
+        ~persistent_rope_vector()
+        {
+            release(root, false);
+        }
+
+        void swap(persistent_rope_vector& other) noexcept
+        {
+            std::swap(alloc, other.alloc);
+            std::swap(root, other.root);
+            std::swap(height, other.height);
+            std::swap(total_size, other.total_size);
+        }
+
+        allocator_type get_allocator() const noexcept
+        {
+            return alloc;
+        }
+
+        size_type size() const noexcept
+        {
+            return total_size;
+        }
+
+        bool empty() const noexcept
+        {
+            return total_size == 0;
+        }
+
+        const T& operator[](size_type i) const
+        {
+            assert(i < total_size);
+            const chunk* c = locate(i);
+            return c->slots[i];
+        }
+
+        const T& at(size_type i) const
+        {
+            assert(i < total_size && "rvec::at() index out of range");
+            return (*this)[i];
+        }
+
+        const T& front() const
+        {
+            assert(!empty() && "rvec::front() called on empty vector");
+            return (*this)[0];
+        }
+
+        const T& back() const
+        {
+            assert(!empty() && "rvec::back() called on empty vector");
+            return (*this)[total_size - 1];
+        }
+
+        // the version with element i replaced by value
+        persistent_rope_vector set(size_type i, const T& value) const
+        {
+            return assigned(i, value);
+        }
+
+        persistent_rope_vector set(size_type i, T&& value) const
+        {
+            return assigned(i, std::move(value));
+        }
+
+        // the version with value inserted before position pos
+        persistent_rope_vector insert(size_type pos, const T& value) const
+        {
+            return inserted(pos, value);
+        }
+
+        persistent_rope_vector insert(size_type pos, T&& value) const
+        {
+            return inserted(pos, std::move(value));
+        }
+
+        persistent_rope_vector push_back(const T& value) const
+        {
+            return inserted(total_size, value);
+        }
+
+        persistent_rope_vector push_back(T&& value) const
+        {
+            return inserted(total_size, std::move(value));
+        }
+
+        // the version without element pos; a chunk that empties is unlinked
+        persistent_rope_vector erase(size_type pos) const
+        {
+            assert(pos < total_size && "erase position out of bounds");
+            return edited(pos, total_size - 1, [](persistent_rope_vector& out, const chunk* c, size_type offset)
+                {
+                    if (c->count == 1)
+                    {
+                        return edit{};
+                    }
+
+                    size_type n = c->count - 1;
+                    chunk* copy = out.make_chunk(n, [&](T* p, size_type j)
+                        {
+                            alloc_traits::construct(out.alloc, p, c->slots[j < offset ? j : j + 1]);
+                        });
+                    return edit{ copy, n };
+                });
+        }
+
+        // calls f(const T* data, size_t n) for every chunk, in order; if f returns bool, false stops the walk
+        template <typename F>
+        void for_each_chunk(F&& f) const
+        {
+            if (root)
+            {
+                visit(root, f);
+            }
+        }
+
+        bool operator==(const persistent_rope_vector& other) const
+        {
+            if (total_size != other.total_size)
+            {
+                return false;
+            }
+            if (root == other.root)
+            {
+                return true;
+            }
+
+            const_iterator a = begin();
+            for (const_iterator b = other.begin(); b != other.end(); ++a, ++b)
+            {
+                if (!(*a == *b))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool operator!=(const persistent_rope_vector& other) const
+        {
+            return !(*this == other);
+        }
+
+        // iterators cache the chunk they are in and step by pointer inside it
+        class const_iterator
+        {
+        public:
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const T*;
+            using reference = const T&;
+
+        private:
+            const persistent_rope_vector* parent = nullptr;
+            size_type index = 0;
+            const T* cur = nullptr;
+            const T* first = nullptr; // bounds of the chunk holding cur
+            const T* last = nullptr;
+
+            void seat()
+            {
+                if (index >= parent->total_size)
+                {
+                    cur = first = last = nullptr;
+                    return;
+                }
+
+                size_type offset = index;
+                const chunk* c = parent->locate(offset);
+                first = c->slots;
+                last = c->slots + c->count;
+                cur = first + offset;
+            }
+
+        public:
+            const_iterator() = default;
+
+            const_iterator(const persistent_rope_vector* v, size_type i)
+                : parent(v), index(i)
+            {
+                seat();
+            }
+
+            reference operator*() const
+            {
+                return *cur;
+            }
+
+            pointer operator->() const
+            {
+                return cur;
+            }
+
+            const_iterator& operator++()
+            {
+                ++index;
+                if (++cur == last)
+                {
+                    seat();
+                }
+                return *this;
+            }
+
+            const_iterator operator++(int)
+            {
+                const_iterator tmp = *this;
+                ++(*this);
+                return tmp;
+            }
+
+            const_iterator& operator--()
+            {
+                --index;
+                if (cur == first)
+                {
+                    seat();
+                }
+                else
+                {
+                    --cur;
+                }
+                return *this;
+            }
+
+            const_iterator operator--(int)
+            {
+                const_iterator tmp = *this;
+                --(*this);
+                return tmp;
+            }
+
+            const_iterator& operator+=(difference_type n)
+            {
+                index += n;
+                if (cur && n >= first - cur && n < last - cur)
+                {
+                    cur += n;
+                }
+                else
+                {
+                    seat();
+                }
+                return *this;
+            }
+
+            const_iterator& operator-=(difference_type n)
+            {
+                return *this += -n;
+            }
+
+            const_iterator operator+(difference_type n) const
+            {
+                const_iterator tmp = *this;
+                return tmp += n;
+            }
+
+            const_iterator operator-(difference_type n) const
+            {
+                const_iterator tmp = *this;
+                return tmp -= n;
+            }
+
+            friend const_iterator operator+(difference_type n, const const_iterator& it)
+            {
+                return it + n;
+            }
+
+            reference operator[](difference_type n) const
+            {
+                return *(*this + n);
+            }
+
+            friend difference_type operator-(const const_iterator& a, const const_iterator& b)
+            {
+                return static_cast<difference_type>(a.index) - static_cast<difference_type>(b.index);
+            }
+
+            friend bool operator==(const const_iterator& a, const const_iterator& b)
+            {
+                return a.parent == b.parent && a.index == b.index;
+            }
+
+            friend bool operator!=(const const_iterator& a, const const_iterator& b)
+            {
+                return !(a == b);
+            }
+
+            friend bool operator<(const const_iterator& a, const const_iterator& b)
+            {
+                return a.index < b.index;
+            }
+
+            friend bool operator>(const const_iterator& a, const const_iterator& b)
+            {
+                return a.index > b.index;
+            }
+
+            friend bool operator<=(const const_iterator& a, const const_iterator& b)
+            {
+                return a.index <= b.index;
+            }
+
+            friend bool operator>=(const const_iterator& a, const const_iterator& b)
+            {
+                return a.index >= b.index;
+            }
+        };
+
+        using iterator = const_iterator;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+        using reverse_iterator = const_reverse_iterator;
+
+        const_iterator cbegin() const noexcept
+        {
+            return const_iterator(this, 0);
+        }
+
+        const_iterator cend() const noexcept
+        {
+            return const_iterator(this, total_size);
+        }
+
+        const_iterator begin() const noexcept
+        {
+            return cbegin();
+        }
+
+        const_iterator end() const noexcept
+        {
+            return cend();
+        }
+
+        const_reverse_iterator rbegin() const
+        {
+            return const_reverse_iterator(end());
+        }
+
+        const_reverse_iterator rend() const
+        {
+            return const_reverse_iterator(begin());
+        }
+
+    private:
+        template <typename V>
+        persistent_rope_vector assigned(size_type i, V&& value) const
+        {
+            assert(i < total_size && "set position out of bounds");
+            return edited(i, total_size, [&value](persistent_rope_vector& out, const chunk* c, size_type offset)
+                {
+                    chunk* copy = out.make_chunk(c->count, [&](T* p, size_type j)
+                        {
+                            if (j == offset)
+                            {
+                                alloc_traits::construct(out.alloc, p, std::forward<V>(value));
+                            }
+                            else
+                            {
+                                alloc_traits::construct(out.alloc, p, c->slots[j]);
+                            }
+                        });
+                    return edit{ copy, c->count };
+                });
+        }
+
+        template <typename F>
+        static bool visit(const branch* b, F& f)
+        {
+            for (size_type k = 0; k < b->size; ++k)
+            {
+                if (!b->bottom)
+                {
+                    if (!visit(static_cast<const branch*>(b->children[k]), f))
+                    {
+                        return false;
+                    }
+                    continue;
+                }
+
+                const chunk* c = static_cast<const chunk*>(b->children[k]);
+                const T* data = c->slots;
+                if constexpr (std::is_same<decltype(f(data, c->count)), bool>::value)
+                {
+                    if (!f(data, c->count))
+                    {
+                        return false;
+                    }
+                }
+                else
+                {
+                    f(data, c->count);
+                }
+            }
+            return true;
+        }
+    };
+
+    template <typename T, std::size_t ChunkSize, typename Allocator>
+    void swap(persistent_rope_vector<T, ChunkSize, Allocator>& a, persistent_rope_vector<T, ChunkSize, Allocator>& b) noexcept
+    {
+        a.swap(b);
+    }
+} // namespace rvec
@@ -2,328 +2,3209 @@
 
 #include <vector>
 #include <memory>
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// keeps the cold half of a fast path out of line so the hot half inlines into its callers
+#if defined(__GNUC__) || defined(__clang__)
+#define RVEC_NOINLINE __attribute__((noinline))
+#elif defined(_MSC_VER)
+#define RVEC_NOINLINE __declspec(noinline)
+#else
+#define RVEC_NOINLINE
+#endif
 
 namespace rvec
 {
 
-    template <typename T, std::size_t ChunkSize = 256>
+    template <typename T, std::size_t ChunkSize = 256, typename Allocator = std::allocator<T>>
     class rope_vector
     {
     public:
         using value_type = T;
         using size_type = std::size_t;
+        using allocator_type = Allocator;
 
         ~rope_vector()
         {
-            for (T* chunk : chunks)
-            {
-                free_chunk(chunk);
-            }
+            forget();
+            release_all();
+            trim();
         }
 
         size_type memory_used() const
         {
             // returns total memory used by all chunks in bytes
-            return chunks.size() * ChunkSize * sizeof(T);
+            return (chunk_count + spare_chunks.size()) * ChunkSize * sizeof(T);
         }
 
         double fragmentation() const
         {
             // returns 1.0 = completely unused; 0.0 = fully packed
-            if (chunks.empty())
+            size_type total_slots = (chunk_count + spare_chunks.size()) * ChunkSize;
+            if (total_slots == 0)
             {
                 return 0.0;
             }
 
-            size_type used_slots = total_size;
-            size_type total_slots = chunks.size() * ChunkSize;
-
-            return 1.0 - static_cast<double>(used_slots) / total_slots;
+            return 1.0 - static_cast<double>(total_size) / total_slots;
         }
 
     private:
-        std::vector<T*> chunks;
-        size_type total_size = 0;
-        size_type start_index = 0; // for logical indexing
-        size_type front_chunk_index = 0;
+        static_assert(ChunkSize > 0, "rvec::rope_vector needs a non-zero chunk size");
 
-        static constexpr size_type chunk_index(size_type i)
+        // the chunk directory is a counted B+tree. branches record how many elements live
+        // under each child, so an index is found by walking down the counts. chunks are the
+        // leaves and hold anywhere from 1 to ChunkSize elements, which lets an edit touch a
+        // single chunk and split/merge it instead of shifting the rest of the sequence.
+        static constexpr size_type branch_capacity = 16;
+
+        struct node
         {
-            return i / ChunkSize;
-        }
+        };
 
-        static constexpr size_type within_chunk_index(size_type i)
+        // a chunk header and its ChunkSize raw slots share one allocation. only the live
+        // slots hold constructed objects; the gap is uninitialized storage. copies of a
+        // container link the same chunks; a chunk with more than one owner is read-only.
+        struct chunk : node
         {
-            return i % ChunkSize;
-        }
+            T* slots = nullptr;
+            size_type count = 0; // live elements
+            size_type gap = 0; // offset of the unused slots; == count when the chunk is packed
+            std::atomic<size_type> owners{ 1 }; // containers linking this chunk
+        };
+
+        struct branch : node
+        {
+            branch* parent = nullptr;
+            bool bottom = true; // children are chunks rather than branches
+            size_type size = 0; // number of children
+            size_type counts[branch_capacity] = {};
+            node* children[branch_capacity] = {};
+        };
 
-        void ensure_capacity_for(size_type i)
+        // a chunk is addressed by the bottom branch that owns it and its slot in that branch
+        struct cursor
         {
-            while (i >= chunks.size() * ChunkSize)
+            branch* parent = nullptr;
+            size_type slot = 0;
+            size_type offset = 0; // element offset inside the chunk
+
+            chunk* leaf() const
             {
-                // chunks.emplace_back(std::make_unique<T[]>(ChunkSize));
-                chunks.emplace_back(allocate_chunk()); // decouples allocation logic from smart pointer strategy
+                return static_cast<chunk*>(parent->children[slot]);
             }
-        }
+        };
+
+        using alloc_traits = std::allocator_traits<Allocator>;
 
-        void grow_front()
+        template <typename U>
+        using rebind_alloc = typename alloc_traits::template rebind_alloc<U>;
+
+        template <typename U>
+        using rebind_traits = typename alloc_traits::template rebind_traits<U>;
+
+        // lists of chunks come from the container's allocator too
+        using chunk_list = std::vector<chunk*, rebind_alloc<chunk*>>;
+
+        Allocator alloc;
+        branch* root = nullptr;
+        branch* tail_branch = nullptr; // parent of the last chunk; null whenever the tree is reshaped
+        size_type height = 0; // branch levels above the chunks, 0 when empty
+        size_type chunk_count = 0;
+        size_type total_size = 0;
+        chunk_list spare_chunks; // retired or reserved chunks, drained before allocating
+        branch* spare_branches = nullptr; // retired branches, linked through parent
+        size_type spare_branch_count = 0;
+        size_type spare_high_water = 4; // retired chunks/branches kept beyond this go back to the allocator
+        bool editing = false; // chunks keep their gap at the last edit instead of packing
+
+        // one step of the undo history: the region [pos, pos + cut) of the sequence stands in
+        // for the held chunks, which hold held_size elements. swapping the two reverts the step
+        // and turns it into its own inverse, so undo and redo are the same operation.
+        struct journal_step
         {
-            chunks.insert(chunks.begin(), allocate_chunk());
-            start_index += ChunkSize;
-            ++front_chunk_index;
-        }
+            size_type pos = 0;
+            size_type cut = 0;
+            chunk_list held;
+            size_type held_size = 0;
+
+            explicit journal_step(const Allocator& a)
+                : held(rebind_alloc<chunk*>(a))
+            {
+            }
+        };
+
+        using step_list = std::vector<journal_step, rebind_alloc<journal_step>>;
+        using mark_list = std::vector<size_type, rebind_alloc<size_type>>;
 
-        T* allocate_chunk()
+        // the history lives as long as the container, so it is drawn from the same allocator
+        struct journal
         {
-            // std::cout << "[allocating chunk]" << std::endl;
-            return new T[ChunkSize];
+            step_list undo; // oldest first; the open group's steps are last
+            mark_list undo_marks; // index of the first step of every group
+            step_list redo;
+            mark_list redo_marks;
+            size_type depth = 0; // begin_group() calls not yet closed
+            bool lost = false; // the history was dropped inside the open group
+
+            explicit journal(const Allocator& a)
+                : undo(rebind_alloc<journal_step>(a)),
+                undo_marks(rebind_alloc<size_type>(a)),
+                redo(rebind_alloc<journal_step>(a)),
+                redo_marks(rebind_alloc<size_type>(a))
+            {
+            }
+        };
+
+        struct journal_deleter
+        {
+            rebind_alloc<journal> alloc;
+
+            void operator()(journal* j)
+            {
+                rebind_traits<journal>::destroy(alloc, j);
+                rebind_traits<journal>::deallocate(alloc, j, 1);
+            }
+        };
+
+        using journal_ptr = std::unique_ptr<journal, journal_deleter>;
+
+        journal_ptr history{ nullptr, journal_deleter{ rebind_alloc<journal>(alloc) } }; // null until the first begin_group()
+
+        template <typename... Args>
+        void construct(T* p, Args&&... args)
+        {
+            alloc_traits::construct(alloc, p, std::forward<Args>(args)...);
         }
 
-        void free_chunk(T* chunk)
+        void destroy(T* p)
         {
-            // std::cout << "[freeing chunk]" << std::endl;
-            delete[] chunk;
+            alloc_traits::destroy(alloc, p);
         }
 
-    public:
-        rope_vector() = default;
+        // maps a live element offset past the gap of a chunk
+        static T& element(chunk* c, size_type offset)
+        {
+            return c->slots[offset < c->gap ? offset : offset + (ChunkSize - c->count)];
+        }
 
-        // move constructor
-        rope_vector(rope_vector&& other) noexcept
-            : chunks(std::move(other.chunks)),
-            total_size(other.total_size),
-            start_index(other.start_index),
-            front_chunk_index(other.front_chunk_index)
+        // move-constructs *from into the raw slot `to` and ends the lifetime of *from
+        void relocate(T* from, T* to)
         {
-            other.total_size = 0;
-            other.start_index = 0;
-            other.front_chunk_index = 0;
+            construct(to, std::move(*from));
+            destroy(from);
         }
 
-        // move assignment
-        rope_vector& operator=(rope_vector&& other) noexcept
+        // relocates n elements from `first` to the raw slots at `dest`; the ranges may overlap.
+        // trivially copyable types move as a single memmove.
+        void shift_slots(T* first, size_type n, T* dest)
         {
-            if (this != &other)
+            if (n == 0 || first == dest)
             {
-                chunks = std::move(other.chunks);
-                total_size = other.total_size;
-                start_index = other.start_index;
-                front_chunk_index = other.front_chunk_index;
-                other.total_size = 0;
-                other.start_index = 0;
-                other.front_chunk_index = 0;
+                return;
+            }
+
+            if constexpr (std::is_trivially_copyable<T>::value)
+            {
+                std::memmove(static_cast<void*>(dest), static_cast<const void*>(first), n * sizeof(T));
+            }
+            else if (dest > first)
+            {
+                for (size_type j = n; j-- > 0;)
+                {
+                    relocate(first + j, dest + j);
+                }
+            }
+            else
+            {
+                for (size_type j = 0; j < n; ++j)
+                {
+                    relocate(first + j, dest + j);
+                }
             }
-            return *this;
         }
 
-        size_type size() const noexcept
+        // slides the unused slots of a chunk so they start at offset `to`
+        void move_gap(chunk* c, size_type to)
         {
-            return total_size;
+            size_type width = ChunkSize - c->count;
+            if (width != 0)
+            {
+                if (to < c->gap)
+                {
+                    shift_slots(c->slots + to, c->gap - to, c->slots + to + width);
+                }
+                else
+                {
+                    shift_slots(c->slots + c->gap + width, to - c->gap, c->slots + c->gap);
+                }
+            }
+            c->gap = to;
         }
 
-        bool empty() const noexcept
+        void destroy_elements(chunk* c)
         {
-            return total_size == 0;
+            for (size_type j = 0; j < c->count; ++j)
+            {
+                destroy(&element(c, j));
+            }
+            c->count = c->gap = 0;
         }
 
-        T& operator[](size_type i)
+        void close_gap(chunk* c)
         {
-            assert(i < total_size);
-            size_type real_index = start_index + i;
-            return chunks[front_chunk_index + chunk_index(real_index)][within_chunk_index(real_index)];
+            move_gap(c, c->count);
         }
 
-        const T& operator[](size_type i) const
+        // drops this container's reference to a chunk; the last owner destroys the elements
+        void release_chunk(chunk* c)
         {
-            assert(i < total_size);
-            size_type real_index = start_index + i;
-            return chunks[front_chunk_index + chunk_index(real_index)][within_chunk_index(real_index)];
+            if (c->owners.load(std::memory_order_acquire) != 1 && c->owners.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            {
+                return;
+            }
+            c->owners.store(1, std::memory_order_relaxed);
+            destroy_elements(c);
+            retire_chunk(c);
         }
 
-        T& at(size_type i)
+        // returns c if this container is its only owner, otherwise a private packed copy of it
+        chunk* unshared(chunk* c)
         {
-            assert(i < total_size && "rvec::at() index out of range");
-            return (*this)[i];
+            if constexpr (std::is_copy_constructible<T>::value)
+            {
+                if (c->owners.load(std::memory_order_acquire) == 1)
+                {
+                    return c;
+                }
+
+                chunk* copy = allocate_chunk();
+                if constexpr (std::is_trivially_copyable<T>::value)
+                {
+                    // the runs before and after the gap, packed
+                    std::memcpy(static_cast<void*>(copy->slots), static_cast<const void*>(c->slots), c->gap * sizeof(T));
+                    std::memcpy(static_cast<void*>(copy->slots + c->gap), static_cast<const void*>(c->slots + c->gap + (ChunkSize - c->count)), (c->count - c->gap) * sizeof(T));
+                }
+                else
+                {
+                    size_type n = 0;
+                    try
+                    {
+                        for (; n < c->count; ++n)
+                        {
+                            construct(copy->slots + n, element(c, n));
+                        }
+                    }
+                    catch (...)
+                    {
+                        while (n-- > 0)
+                        {
+                            destroy(copy->slots + n);
+                        }
+                        retire_chunk(copy);
+                        throw;
+                    }
+                }
+                copy->count = copy->gap = c->count;
+                release_chunk(c);
+                return copy;
+            }
+            else
+            {
+                // containers of move-only elements cannot be copied, so nothing is shared
+                return c;
+            }
         }
 
-        const T& at(size_type i) const
+        // makes the chunk at cursor `at` writable, copying it on the first write after a copy.
+        // the branch is only written when a copy is made, so workers seating writable
+        // iterators in disjoint ranges of an unshared container never touch shared memory.
+        chunk* own(cursor at)
         {
-            assert(i < total_size && "rvec::at() index out of range");
-            return (*this)[i];
+            chunk* c = at.leaf();
+            chunk* mine = unshared(c);
+            if (mine != c)
+            {
+                at.parent->children[at.slot] = mine;
+            }
+            return mine;
         }
 
-        T& front()
+        // finds the chunk holding element i (i < total_size)
+        cursor locate(size_type i) const
         {
-            assert(!empty() && "rvec::front() called on empty vector");
-            return (*this)[0];
+            branch* b = root;
+            for (;;)
+            {
+                size_type k = 0;
+                while (i >= b->counts[k])
+                {
+                    i -= b->counts[k];
+                    ++k;
+                }
+
+                if (b->bottom)
+                {
+                    return cursor{ b, k, i };
+                }
+                b = static_cast<branch*>(b->children[k]);
+            }
         }
 
-        const T& front() const
+        // like locate(), but a position on a chunk seam resolves to the end of the left chunk,
+        // so i == total_size is valid and appending to a chunk is preferred over prepending
+        cursor locate_insert(size_type i) const
         {
-            assert(!empty() && "rvec::front() called on empty vector");
-            return (*this)[0];
+            branch* b = root;
+            for (;;)
+            {
+                size_type k = 0;
+                while (k + 1 < b->size && i > b->counts[k])
+                {
+                    i -= b->counts[k];
+                    ++k;
+                }
+
+                if (b->bottom)
+                {
+                    return cursor{ b, k, i };
+                }
+                b = static_cast<branch*>(b->children[k]);
+            }
         }
 
-        T& back()
+        cursor front_cursor() const
         {
-            assert(!empty() && "rvec::back() called on empty vector");
-            return (*this)[total_size - 1];
+            branch* b = root;
+            while (!b->bottom)
+            {
+                b = static_cast<branch*>(b->children[0]);
+            }
+            return cursor{ b, 0, 0 };
         }
 
-        const T& back() const
+        cursor back_cursor() const
         {
-            assert(!empty() && "rvec::back() called on empty vector");
-            return (*this)[total_size - 1];
+            branch* b = root;
+            while (!b->bottom)
+            {
+                b = static_cast<branch*>(b->children[b->size - 1]);
+            }
+            cursor at{ b, b->size - 1, 0 };
+            at.offset = at.leaf()->count;
+            return at;
         }
 
-        // TODO: we reset the logical size but don't free the memory. handle l8r
-        void clear()
+        // steps to the next chunk in sequence order; returns false past the last one
+        static bool next_chunk(cursor& at)
         {
-            for (auto chunk : chunks)
+            at.offset = 0;
+            if (at.slot + 1 < at.parent->size)
             {
-                free_chunk(chunk);
+                ++at.slot;
+                return true;
             }
-            chunks.clear();
-            total_size = 0;
-            start_index = 0;
-            front_chunk_index = 0;
+
+            branch* b = at.parent;
+            size_type depth = 0;
+            for (;;)
+            {
+                branch* p = b->parent;
+                if (!p)
+                {
+                    return false;
+                }
+
+                size_type k = child_slot(p, b);
+                ++depth;
+                if (k + 1 < p->size)
+                {
+                    b = static_cast<branch*>(p->children[k + 1]);
+                    break;
+                }
+                b = p;
+            }
+
+            while (--depth > 0)
+            {
+                b = static_cast<branch*>(b->children[0]);
+            }
+            at.parent = b;
+            at.slot = 0;
+            return true;
         }
 
-        void resize(size_type new_size)
+        // hands f each contiguous run of elements in sequence order; stops early when f returns false
+        template <typename Ptr, typename F>
+        void visit_runs(F& f) const
         {
-            if (new_size < total_size)
+            if (!root)
             {
-                total_size = new_size;
+                return;
             }
-            else
+
+            cursor at = front_cursor();
+            do
             {
-                ensure_capacity_for(start_index + new_size - 1);
-                for (size_type i = total_size; i < new_size; ++i)
+                chunk* c = at.leaf();
+                if constexpr (!std::is_const<std::remove_pointer_t<Ptr>>::value)
+                {
+                    c = const_cast<rope_vector*>(this)->own(at);
+                }
+                size_type tail = c->count - c->gap;
+                if (c->gap != 0 && !call_run<Ptr>(f, c->slots, c->gap))
+                {
+                    return;
+                }
+                if (tail != 0 && !call_run<Ptr>(f, c->slots + ChunkSize - tail, tail))
                 {
-                    chunks[chunk_index(i)][within_chunk_index(i)] = T{};
+                    return;
                 }
-                total_size = new_size;
+            } while (next_chunk(at));
+        }
+
+        template <typename Ptr, typename F>
+        static bool call_run(F& f, Ptr data, size_type n)
+        {
+            if constexpr (std::is_same<decltype(f(data, n)), bool>::value)
+            {
+                return f(data, n);
+            }
+            else
+            {
+                f(data, n);
+                return true;
             }
         }
 
-        // ensures enough chunks to hold at least n elements
-        void reserve(size_type n)
+        // points cur at element i and [first, last) at the contiguous run of slots holding it;
+        // past the end all three are null
+        void seat_run(size_type i, T*& cur, T*& first, T*& last) const
         {
-            if (n > capacity())
+            if (i >= total_size)
             {
-                ensure_capacity_for(start_index + n - 1);
+                cur = first = last = nullptr;
+                return;
             }
+
+            cursor at = locate(i);
+            seat_in(at.leaf(), at.offset, cur, first, last);
         }
 
-        // returns how many elements can be stored without growing
-        size_type capacity() const noexcept
+        // like seat_run(), but first makes the chunk writable
+        void seat_owned_run(size_type i, T*& cur, T*& first, T*& last)
         {
-            return (chunks.size() - front_chunk_index) * ChunkSize - start_index;
+            if (i >= total_size)
+            {
+                cur = first = last = nullptr;
+                return;
+            }
+
+            cursor at = locate(i);
+            seat_in(own(at), at.offset, cur, first, last);
         }
 
-        // deallocates unused chunks beyond current size
-        void shrink_to_fit()
+        static void seat_in(chunk* c, size_type offset, T*& cur, T*& first, T*& last)
         {
-            size_type required_chunks = chunk_index(start_index + total_size) + (within_chunk_index(start_index + total_size) ? 1 : 0);
-            while (chunks.size() > required_chunks)
+            if (offset < c->gap)
+            {
+                first = c->slots;
+                last = c->slots + c->gap;
+            }
+            else
             {
-                // free_chunk(chunks.back().release());
-                free_chunk(chunks.back()); // no more unique_ptr
-                chunks.pop_back();
+                first = c->slots + c->gap + (ChunkSize - c->count);
+                last = c->slots + ChunkSize;
             }
+            cur = &element(c, offset);
         }
 
-        void push_back(const T& value)
+        static size_type child_slot(const branch* b, const node* child)
         {
-            ensure_capacity_for(start_index + total_size);
-            (*this)[total_size++] = value;
+            size_type k = 0;
+            while (b->children[k] != child)
+            {
+                ++k;
+            }
+            return k;
         }
 
-        void push_back(T&& value)
+        // adds n to the count of b's child at slot and to every ancestor on the way up
+        static void grow_counts(branch* b, size_type slot, size_type n)
         {
-            ensure_capacity_for(start_index + total_size);
-            (*this)[total_size++] = std::move(value);
+            b->counts[slot] += n;
+            for (branch* p = b->parent; p; b = p, p = p->parent)
+            {
+                p->counts[child_slot(p, b)] += n;
+            }
         }
 
-        template <typename... Args>
-        void emplace_back(Args&&... args)
+        static void shrink_counts(branch* b, size_type slot, size_type n)
         {
-            ensure_capacity_for(start_index + total_size);
-            new (&(*this)[total_size++]) T(std::forward<Args>(args)...);
+            b->counts[slot] -= n;
+            for (branch* p = b->parent; p; b = p, p = p->parent)
+            {
+                p->counts[child_slot(p, b)] -= n;
+            }
         }
 
-        // TODO: insert optimization - choose the cheapest direction to shift existing elements...
-        // ...improves performance for mid/front insertions by avoiding unnecessary moves
-        void insert(size_type pos, T&& value)
+        static size_type branch_total(const branch* b)
         {
-            assert(pos <= total_size);
-            ensure_capacity_for(start_index + total_size);
+            size_type sum = 0;
+            for (size_type k = 0; k < b->size; ++k)
+            {
+                sum += b->counts[k];
+            }
+            return sum;
+        }
 
-            if (pos == 0)
+        // inserts child (holding count elements) at slot of b, splitting full branches on the
+        // way up, and adds count to every ancestor. returns where the child ended up.
+        cursor link_child(branch* b, size_type slot, node* child, size_type count)
+        {
+            tail_branch = nullptr;
+            if (b->size == branch_capacity)
             {
-                if (start_index == 0)
+                // appends and prepends split at the edge so sequential growth stays packed
+                size_type keep = slot == branch_capacity ? branch_capacity : slot == 0 ? 0 : branch_capacity / 2;
+
+                if (b == root)
+                {
+                    branch* top = allocate_branch(false);
+                    top->children[0] = b;
+                    top->counts[0] = branch_total(b);
+                    top->size = 1;
+                    b->parent = top;
+                    root = top;
+                    ++height;
+                }
+
+                branch* sibling = allocate_branch(b->bottom);
+                size_type moved = 0;
+                for (size_type k = keep; k < b->size; ++k)
+                {
+                    sibling->children[k - keep] = b->children[k];
+                    sibling->counts[k - keep] = b->counts[k];
+                    moved += b->counts[k];
+                    if (!b->bottom)
+                    {
+                        static_cast<branch*>(b->children[k])->parent = sibling;
+                    }
+                }
+                sibling->size = b->size - keep;
+                b->size = keep;
+
+                branch* p = b->parent;
+                size_type at = child_slot(p, b);
+                shrink_counts(p, at, moved);
+                link_child(p, at + 1, sibling, moved);
+
+                if (slot > keep || (slot == keep && keep == branch_capacity))
                 {
-                    grow_front();
+                    b = sibling;
+                    slot -= keep;
                 }
-                --start_index;
-                ++total_size;
-                (*this)[0] = std::move(value);
             }
-            else if (pos == total_size)
+
+            for (size_type k = b->size; k > slot; --k)
+            {
+                b->children[k] = b->children[k - 1];
+                b->counts[k] = b->counts[k - 1];
+            }
+            b->children[slot] = child;
+            b->counts[slot] = 0;
+            ++b->size;
+            if (!b->bottom)
+            {
+                static_cast<branch*>(child)->parent = b;
+            }
+
+            grow_counts(b, slot, count);
+            return cursor{ b, slot, 0 };
+        }
+
+        // removes the child at slot of b; its count must already be zero
+        void unlink_child(branch* b, size_type slot)
+        {
+            tail_branch = nullptr;
+            for (size_type k = slot; k + 1 < b->size; ++k)
+            {
+                b->children[k] = b->children[k + 1];
+                b->counts[k] = b->counts[k + 1];
+            }
+            --b->size;
+
+            if (b == root)
+            {
+                collapse_root();
+                return;
+            }
+
+            if (b->size == 0)
+            {
+                branch* p = b->parent;
+                size_type at = child_slot(p, b);
+                retire_branch(b);
+                unlink_child(p, at);
+            }
+            else if (b->size < branch_capacity / 4)
+            {
+                merge_branch(b);
+            }
+        }
+
+        // folds an underfull branch into a neighbour under the same parent when they fit
+        void merge_branch(branch* b)
+        {
+            branch* p = b->parent;
+            size_type at = child_slot(p, b);
+            bool into_prev = at > 0;
+            if (!into_prev && at + 1 == p->size)
+            {
+                return;
+            }
+
+            branch* sibling = static_cast<branch*>(p->children[into_prev ? at - 1 : at + 1]);
+            if (sibling->size + b->size > branch_capacity)
+            {
+                return;
+            }
+
+            if (into_prev)
             {
-                push_back(std::move(value));
+                for (size_type k = 0; k < b->size; ++k)
+                {
+                    sibling->children[sibling->size + k] = b->children[k];
+                    sibling->counts[sibling->size + k] = b->counts[k];
+                }
             }
-            else if (pos < total_size / 2)
+            else
             {
-                if (start_index == 0)
+                for (size_type k = sibling->size; k-- > 0;)
                 {
-                    grow_front();
+                    sibling->children[k + b->size] = sibling->children[k];
+                    sibling->counts[k + b->size] = sibling->counts[k];
                 }
-                --start_index;
-                ++total_size;
-                for (size_type i = 0; i < pos; ++i)
+                for (size_type k = 0; k < b->size; ++k)
                 {
-                    (*this)[i] = std::move((*this)[i + 1]);
+                    sibling->children[k] = b->children[k];
+                    sibling->counts[k] = b->counts[k];
                 }
-                (*this)[pos] = std::move(value);
             }
-            else
+            if (!b->bottom)
             {
-                for (size_type i = total_size; i > pos; --i)
+                for (size_type k = 0; k < b->size; ++k)
                 {
-                    (*this)[i] = std::move((*this)[i - 1]);
+                    static_cast<branch*>(b->children[k])->parent = sibling;
                 }
-                (*this)[pos] = std::move(value);
-                ++total_size;
             }
+            sibling->size += b->size;
+
+            p->counts[into_prev ? at - 1 : at + 1] += p->counts[at];
+            p->counts[at] = 0;
+            retire_branch(b);
+            unlink_child(p, at);
         }
 
-        void erase(size_type pos)
+        void collapse_root()
         {
-            assert(pos < total_size && "erase position out of bounds");
+            while (height > 1 && root->size == 1)
+            {
+                branch* only = static_cast<branch*>(root->children[0]);
+                retire_branch(root);
+                only->parent = nullptr;
+                root = only;
+                --height;
+            }
+
+            if (root->size == 0)
+            {
+                retire_branch(root);
+                root = nullptr;
+                height = 0;
+            }
+        }
+
+        // links a fresh chunk after the last one and returns a cursor to it
+        cursor grow_back()
+        {
+            chunk* c = allocate_chunk();
+            ++chunk_count;
+            if (!root)
+            {
+                root = allocate_branch(true);
+                height = 1;
+                return link_child(root, 0, c, 0);
+            }
+
+            cursor last = back_cursor();
+            return link_child(last.parent, last.slot + 1, c, 0);
+        }
+
+        // links a fresh chunk before the first one and returns a cursor to it
+        cursor grow_front()
+        {
+            if (!root)
+            {
+                return grow_back();
+            }
+
+            chunk* c = allocate_chunk();
+            ++chunk_count;
+            cursor first = front_cursor();
+            return link_child(first.parent, 0, c, 0);
+        }
+
+        // finds the last chunk with a free slot at its end, growing if needed
+        cursor append_cursor()
+        {
+            cursor at = root ? back_cursor() : cursor{};
+            if (!root || at.offset == ChunkSize)
+            {
+                at = grow_back();
+            }
+
+            close_gap(own(at));
+            tail_branch = at.parent;
+            return at;
+        }
+
+        template <typename... Args>
+        RVEC_NOINLINE void emplace_back_slow(Args&&... args)
+        {
+            // built aside first: append_cursor() may close the tail chunk's gap, moving the
+            // element an argument refers to
+            alignas(T) unsigned char aside[sizeof(T)];
+            T* made = reinterpret_cast<T*>(aside);
+            construct(made, std::forward<Args>(args)...);
+            cursor at;
+            chunk* c;
+            try
+            {
+                at = append_cursor();
+                c = at.leaf();
+                relocate(made, c->slots + c->count);
+            }
+            catch (...)
+            {
+                destroy(made);
+                throw;
+            }
+            ++c->count;
+            ++c->gap;
+            grow_counts(at.parent, at.slot, 1);
+            ++total_size;
+            note_insert(total_size - 1, 1);
+        }
+
+        // makes room in a full chunk for an insert at cursor `at` and returns the new target
+        cursor split_for_insert(cursor at)
+        {
+            if (at.offset == ChunkSize)
+            {
+                chunk* c = allocate_chunk();
+                ++chunk_count;
+                return link_child(at.parent, at.slot + 1, c, 0);
+            }
+            if (at.offset == 0)
+            {
+                chunk* c = allocate_chunk();
+                ++chunk_count;
+                return link_child(at.parent, at.slot, c, 0);
+            }
+
+            chunk* left = own(at);
+            chunk* right = allocate_chunk();
+            ++chunk_count;
+
+            // a full chunk has no gap, so its slots are already in order
+            size_type keep = ChunkSize / 2;
+            size_type moved = ChunkSize - keep;
+            shift_slots(left->slots + keep, moved, right->slots);
+            right->count = right->gap = moved;
+            left->count = left->gap = keep;
+
+            shrink_counts(at.parent, at.slot, moved);
+            cursor next = link_child(at.parent, at.slot + 1, right, moved);
+            if (at.offset > keep)
+            {
+                next.offset = at.offset - keep;
+                return next;
+            }
+
+            // the left half stays directly before the right one, possibly across a branch split
+            if (next.slot > 0)
+            {
+                return cursor{ next.parent, next.slot - 1, at.offset };
+            }
+            return cursor{ at.parent, at.parent->size - 1, at.offset };
+        }
+
+        // drops an empty chunk or folds a sparse one into a neighbour under the same branch
+        void rebalance(cursor at)
+        {
+            chunk* c = at.leaf();
+            if (c->count == 0)
+            {
+                drop_chunk(at);
+                return;
+            }
+            if (c->count >= ChunkSize / 4)
+            {
+                return;
+            }
+
+            branch* b = at.parent;
+            size_type limit = ChunkSize - ChunkSize / 4;
+            if (at.slot > 0)
+            {
+                chunk* prev = static_cast<chunk*>(b->children[at.slot - 1]);
+                if (prev->count + c->count <= limit)
+                {
+                    prev = own(cursor{ b, at.slot - 1, 0 });
+                    close_gap(prev);
+                    close_gap(c);
+                    shift_slots(c->slots, c->count, prev->slots + prev->count);
+                    prev->count += c->count;
+                    prev->gap = prev->count;
+                    b->counts[at.slot - 1] += c->count;
+                    b->counts[at.slot] = 0;
+                    c->count = c->gap = 0;
+                    drop_chunk(at);
+                    return;
+                }
+            }
+            if (at.slot + 1 < b->size)
+            {
+                chunk* next = static_cast<chunk*>(b->children[at.slot + 1]);
+                if (next->count + c->count <= limit)
+                {
+                    next = own(cursor{ b, at.slot + 1, 0 });
+                    close_gap(c);
+                    close_gap(next);
+                    shift_slots(next->slots, next->count, c->slots + c->count);
+                    c->count += next->count;
+                    c->gap = c->count;
+                    b->counts[at.slot] += next->count;
+                    b->counts[at.slot + 1] = 0;
+                    next->count = next->gap = 0;
+                    drop_chunk(cursor{ b, at.slot + 1, 0 });
+                }
+            }
+        }
+
+        // frees an empty chunk and removes it from the tree
+        void drop_chunk(cursor at)
+        {
+            retire_chunk(at.leaf());
+            --chunk_count;
+            unlink_child(at.parent, at.slot);
+        }
+
+        void pack_gaps(branch* b)
+        {
+            for (size_type k = 0; k < b->size; ++k)
+            {
+                if (b->bottom)
+                {
+                    chunk* c = static_cast<chunk*>(b->children[k]);
+                    if (c->gap != c->count)
+                    {
+                        close_gap(own(cursor{ b, k, 0 }));
+                    }
+                }
+                else
+                {
+                    pack_gaps(static_cast<branch*>(b->children[k]));
+                }
+            }
+        }
+
+        // frees every branch and returns the chunks in sequence order
+        void dismantle(node* n, bool is_chunk, chunk_list& out)
+        {
+            if (is_chunk)
+            {
+                out.push_back(static_cast<chunk*>(n));
+                return;
+            }
+
+            branch* b = static_cast<branch*>(n);
+            for (size_type k = 0; k < b->size; ++k)
+            {
+                dismantle(b->children[k], b->bottom, out);
+            }
+            retire_branch(b);
+        }
+
+        chunk_list dismantle()
+        {
+            chunk_list out(alloc);
+            out.reserve(chunk_count);
+            dismantle(out);
+            return out;
+        }
+
+        // appends the chunks to out, which must already have room for them
+        void dismantle(chunk_list& out)
+        {
+            assert(out.capacity() - out.size() >= chunk_count);
+            if (root)
+            {
+                dismantle(root, false, out);
+            }
+            root = nullptr;
+            height = 0;
+        }
+
+        // bulk-loads a packed tree over chunks given in sequence order. if an allocation
+        // throws, the branches built so far are retired and the chunks stay unlinked.
+        void build_index(const chunk_list& leaves)
+        {
+            if (leaves.empty())
+            {
+                return;
+            }
+
+            tail_branch = nullptr;
+            std::vector<node*> level(leaves.begin(), leaves.end());
+            std::vector<size_type> counts;
+            counts.reserve(leaves.size());
+            for (chunk* c : leaves)
+            {
+                counts.push_back(c->count);
+            }
+
+            // a tree over n leaves has at most n branches
+            std::vector<branch*> made;
+            made.reserve(leaves.size());
+            size_type levels = height;
+            bool bottom = true;
+            try
+            {
+                do
+                {
+                    std::vector<node*> parents;
+                    std::vector<size_type> parent_counts;
+                    for (size_type k = 0; k < level.size(); k += branch_capacity)
+                    {
+                        branch* b = allocate_branch(bottom);
+                        made.push_back(b);
+                        size_type sum = 0;
+                        for (size_type j = k; j < level.size() && j < k + branch_capacity; ++j)
+                        {
+                            b->children[b->size] = level[j];
+                            b->counts[b->size] = counts[j];
+                            ++b->size;
+                            sum += counts[j];
+                            if (!bottom)
+                            {
+                                static_cast<branch*>(level[j])->parent = b;
+                            }
+                        }
+                        parents.push_back(b);
+                        parent_counts.push_back(sum);
+                    }
+
+                    level.swap(parents);
+                    counts.swap(parent_counts);
+                    bottom = false;
+                    ++height;
+                } while (level.size() > 1);
+            }
+            catch (...)
+            {
+                for (branch* b : made)
+                {
+                    retire_branch(b);
+                }
+                height = levels;
+                throw;
+            }
+
+            root = static_cast<branch*>(level[0]);
+        }
+
+        // makes dismantled chunks holding n elements the whole content again
+        void relink(const chunk_list& leaves, size_type n)
+        {
+            try
+            {
+                build_index(leaves);
+            }
+            catch (...)
+            {
+                drop_detached(leaves);
+                throw;
+            }
+            chunk_count = leaves.size();
+            total_size = n;
+        }
+
+        // releases dismantled chunks that cannot be linked back, leaving the container empty
+        void drop_detached(const chunk_list& leaves)
+        {
+            for (chunk* c : leaves)
+            {
+                release_chunk(c);
+            }
+            chunk_count = 0;
+            total_size = 0;
+            forget();
+        }
+
+        // destroys every element; the chunks are retired into the spare cache
+        // walks the tree instead of listing its chunks, since destructors reach this and it
+        // must not allocate
+        void release_all()
+        {
+            if (root)
+            {
+                release_tree(root, false);
+            }
+            root = nullptr;
+            height = 0;
+            chunk_count = 0;
+            total_size = 0;
+        }
+
+        void release_tree(node* n, bool is_chunk)
+        {
+            if (is_chunk)
+            {
+                release_chunk(static_cast<chunk*>(n));
+                return;
+            }
+
+            branch* b = static_cast<branch*>(n);
+            for (size_type k = 0; k < b->size; ++k)
+            {
+                release_tree(b->children[k], b->bottom);
+            }
+            retire_branch(b);
+        }
+
+        chunk* allocate_chunk()
+        {
+            if (!spare_chunks.empty())
+            {
+                chunk* c = spare_chunks.back();
+                spare_chunks.pop_back();
+                return c;
+            }
+
+            // room for every chunk that may later be retired, so retire_chunk() need not grow
+            // the spare list
+            if (spare_chunks.capacity() < spare_high_water)
+            {
+                spare_chunks.reserve(std::min(spare_high_water, std::max(chunk_count + 1, 2 * spare_chunks.capacity())));
+            }
+            return new_chunk();
+        }
+
+        // adds a fresh chunk to the spare list, growing the list before the chunk exists so
+        // that neither leaks if the other allocation fails
+        void park_new_chunk()
+        {
+            if (spare_chunks.size() == spare_chunks.capacity())
+            {
+                spare_chunks.reserve(2 * spare_chunks.size() + 1);
+            }
+            spare_chunks.push_back(new_chunk());
+        }
+
+        // keeps an empty chunk for reuse while the cache is below its high-water mark and the
+        // spare list has room. destructors reach this, so it never allocates
+        void retire_chunk(chunk* c)
+        {
+            if (spare_chunks.size() < spare_high_water && spare_chunks.size() < spare_chunks.capacity())
+            {
+                spare_chunks.push_back(c);
+            }
+            else
+            {
+                free_chunk(c);
+            }
+        }
+
+        static constexpr std::size_t chunk_alignment = alignof(chunk) > alignof(T) ? alignof(chunk) : alignof(T);
+        static constexpr std::size_t chunk_header = (sizeof(chunk) + alignof(T) - 1) / alignof(T) * alignof(T);
+        static constexpr std::size_t chunk_bytes = chunk_header + ChunkSize * sizeof(T);
+
+        // chunk memory is requested from the allocator as a single object of this type, so a
+        // pooling allocator sees one size class per (sizeof(T), alignof(T), ChunkSize)
+        struct alignas(chunk_alignment) chunk_storage
+        {
+            unsigned char bytes[chunk_bytes];
+        };
+
+        // one untyped allocation holding the header followed by the slots; no T is constructed
+        chunk* new_chunk()
+        {
+            // std::cout << "[allocating chunk]" << std::endl;
+            rebind_alloc<chunk_storage> storage(alloc);
+            chunk_storage* raw = rebind_traits<chunk_storage>::allocate(storage, 1);
+            chunk* c = ::new (static_cast<void*>(raw)) chunk;
+            c->slots = reinterpret_cast<T*>(raw->bytes + chunk_header);
+            return c;
+        }
+
+        // the chunk must hold no live elements
+        void free_chunk(chunk* c)
+        {
+            // std::cout << "[freeing chunk]" << std::endl;
+            assert(c->count == 0);
+            c->~chunk();
+            rebind_alloc<chunk_storage> storage(alloc);
+            rebind_traits<chunk_storage>::deallocate(storage, reinterpret_cast<chunk_storage*>(c), 1);
+        }
+
+        branch* allocate_branch(bool bottom)
+        {
+            branch* b = spare_branches;
+            if (b)
+            {
+                spare_branches = b->parent;
+                --spare_branch_count;
+                *b = branch{};
+            }
+            else
+            {
+                rebind_alloc<branch> branches(alloc);
+                b = rebind_traits<branch>::allocate(branches, 1);
+                rebind_traits<branch>::construct(branches, b);
+            }
+            b->bottom = bottom;
+            return b;
+        }
+
+        void retire_branch(branch* b)
+        {
+            tail_branch = nullptr;
+            if (spare_branch_count < spare_high_water)
+            {
+                b->parent = spare_branches;
+                spare_branches = b;
+                ++spare_branch_count;
+            }
+            else
+            {
+                free_branch(b);
+            }
+        }
+
+        void free_branch(branch* b)
+        {
+            rebind_alloc<branch> branches(alloc);
+            rebind_traits<branch>::destroy(branches, b);
+            rebind_traits<branch>::deallocate(branches, b, 1);
+        }
+
+        // fills an empty container with other's elements. with equal allocators the chunks
+        // themselves are linked under a fresh directory and gain an owner; otherwise the
+        // chunks could not be freed by either side, so the elements are copied.
+        void share(const rope_vector& other)
+        {
+            if (!(alloc == other.alloc))
+            {
+                other.for_each_chunk([this](const T* data, size_type n)
+                    {
+                        for (size_type j = 0; j < n; ++j)
+                        {
+                            emplace_back(data[j]);
+                        }
+                    });
+                return;
+            }
+            if (!other.root)
+            {
+                return;
+            }
+
+            chunk_list leaves(alloc);
+            leaves.reserve(other.chunk_count);
+            cursor at = other.front_cursor();
+            do
+            {
+                leaves.push_back(at.leaf());
+            } while (next_chunk(at));
+
+            build_index(leaves);
+            for (chunk* c : leaves)
+            {
+                c->owners.fetch_add(1, std::memory_order_relaxed);
+            }
+            chunk_count = other.chunk_count;
+            total_size = other.total_size;
+        }
+
+        // makes pos a chunk seam, splitting the chunk that straddles it
+        void split_at(size_type pos)
+        {
+            if (pos == 0 || pos >= total_size)
+            {
+                return;
+            }
+
+            cursor at = locate(pos);
+            if (at.offset == 0)
+            {
+                return;
+            }
+
+            chunk* c = own(at);
+            chunk* right = allocate_chunk();
+            close_gap(c);
+            size_type moved = c->count - at.offset;
+            shift_slots(c->slots + at.offset, moved, right->slots);
+            right->count = right->gap = moved;
+            c->count = c->gap = at.offset;
+            shrink_counts(at.parent, at.slot, moved);
+            ++chunk_count;
+            link_child(at.parent, at.slot + 1, right, moved);
+        }
+
+        // folds a sparse chunk on either side of the seam at pos into a neighbour
+        void mend_seam(size_type pos)
+        {
+            if (pos < total_size)
+            {
+                cursor at = locate(pos);
+                if (at.leaf()->count < ChunkSize / 4)
+                {
+                    own(at);
+                    rebalance(at);
+                }
+            }
+            if (pos != 0 && pos <= total_size)
+            {
+                cursor at = locate(pos - 1);
+                if (at.leaf()->count < ChunkSize / 4)
+                {
+                    own(at);
+                    rebalance(at);
+                }
+            }
+        }
+
+        // unlinks the elements [pos, pos + n) as whole chunks, in sequence order. only the two
+        // chunks at the ends of the range can be split; the cost is O(log n) per chunk.
+        chunk_list cut_chunks(size_type pos, size_type n)
+        {
+            chunk_list out(alloc);
+            if (n == 0)
+            {
+                return out;
+            }
+
+            split_at(pos + n);
+            split_at(pos);
+            while (n != 0)
+            {
+                cursor at = locate(pos);
+                chunk* c = at.leaf();
+                out.push_back(c);
+                n -= c->count;
+                total_size -= c->count;
+                --chunk_count;
+                shrink_counts(at.parent, at.slot, c->count);
+                unlink_child(at.parent, at.slot);
+            }
+            mend_seam(pos);
+            return out;
+        }
+
+        // links the chunks of leaves in before pos, in order, and leaves the list empty
+        void paste_chunks(size_type pos, chunk_list& leaves)
+        {
+            split_at(pos);
+            size_type at_pos = pos;
+            for (chunk* c : leaves)
+            {
+                if (c->count == 0)
+                {
+                    release_chunk(c);
+                    continue;
+                }
+
+                if (!root)
+                {
+                    root = allocate_branch(true);
+                    height = 1;
+                    link_child(root, 0, c, c->count);
+                }
+                else if (at_pos == total_size)
+                {
+                    cursor last = back_cursor();
+                    link_child(last.parent, last.slot + 1, c, c->count);
+                }
+                else
+                {
+                    cursor at = locate(at_pos);
+                    link_child(at.parent, at.slot, c, c->count);
+                }
+                ++chunk_count;
+                total_size += c->count;
+                at_pos += c->count;
+            }
+            leaves.clear();
+            mend_seam(at_pos);
+            mend_seam(pos);
+        }
+
+        // inserts n elements before pos, each constructed by make(slot) in order. if they fit
+        // in the chunk at pos they are built into its gap, which first moves only the elements
+        // between the gap and pos; otherwise they are built into fresh chunks that are linked
+        // in, splitting at most the chunk that straddles pos. nothing changes if make throws.
+        template <typename Make>
+        void insert_made(size_type pos, size_type n, Make make)
+        {
+            assert(pos <= total_size && "insert position out of bounds");
+            if (n == 0)
+            {
+                return;
+            }
+
+            if (root)
+            {
+                cursor at = locate_insert(pos);
+                if (at.leaf()->count + n <= ChunkSize)
+                {
+                    chunk* c = own(at);
+                    move_gap(c, at.offset);
+                    size_type made = 0;
+                    try
+                    {
+                        for (; made < n; ++made)
+                        {
+                            make(c->slots + c->gap);
+                            ++c->gap;
+                            ++c->count;
+                        }
+                    }
+                    catch (...)
+                    {
+                        for (size_type j = 0; j < made; ++j)
+                        {
+                            destroy(c->slots + at.offset + j);
+                        }
+                        c->gap -= made;
+                        c->count -= made;
+                        throw;
+                    }
+                    grow_counts(at.parent, at.slot, n);
+                    total_size += n;
+                    note_insert(pos, n);
+                    return;
+                }
+            }
+
+            chunk_list leaves(alloc);
+            try
+            {
+                leaves.reserve((n + ChunkSize - 1) / ChunkSize);
+                for (size_type made = 0; made < n;)
+                {
+                    chunk* c = allocate_chunk();
+                    leaves.push_back(c);
+                    for (; c->count < ChunkSize && made < n; ++made)
+                    {
+                        make(c->slots + c->count);
+                        c->gap = ++c->count;
+                    }
+                }
+            }
+            catch (...)
+            {
+                for (chunk* c : leaves)
+                {
+                    destroy_elements(c);
+                    retire_chunk(c);
+                }
+                throw;
+            }
+            paste_chunks(pos, leaves);
+            note_insert(pos, n);
+        }
+
+        // destroys the n elements starting at cursor `at`, which all live in its chunk, and
+        // closes the hole from the cheaper side. a packed chunk stays packed: the elements
+        // before the range move right, towards the end of the chunk, or those after it move
+        // left, whichever moves fewer (ties keep the free slots at the front, where repeated
+        // erases at 0 cost nothing). in editing mode, or with the gap inside the chunk, the gap
+        // slides to the nearest end of the range and the range joins it.
+        void erase_in_chunk(cursor at, size_type n)
+        {
+            chunk* c = own(at);
+            size_type first = at.offset;
+            size_type last = first + n;
+            size_type width = ChunkSize - c->count;
+            if (!editing && (c->gap == 0 || c->gap == c->count))
+            {
+                T* base = c->gap == 0 ? c->slots + width : c->slots;
+                size_type head = first;
+                size_type tail = c->count - last;
+                for (size_type j = first; j < last; ++j)
+                {
+                    destroy(base + j);
+                }
+
+                size_type to_back = head + (base == c->slots && width != 0 ? tail : 0);
+                size_type to_front = (base != c->slots ? head : 0) + tail;
+                c->count -= n;
+                if (to_back <= to_front)
+                {
+                    shift_slots(base + last, tail, c->slots + ChunkSize - tail);
+                    shift_slots(base, head, c->slots + ChunkSize - tail - head);
+                    c->gap = 0;
+                }
+                else
+                {
+                    shift_slots(base, head, c->slots);
+                    shift_slots(base + last, tail, c->slots + head);
+                    c->gap = c->count;
+                }
+            }
+            else
+            {
+                move_gap(c, c->gap < first ? first : c->gap > last ? last : c->gap);
+                for (size_type j = first; j < last; ++j)
+                {
+                    destroy(j < c->gap ? c->slots + j : c->slots + j + width);
+                }
+                c->count -= n;
+                c->gap = first;
+            }
+            shrink_counts(at.parent, at.slot, n);
+            total_size -= n;
+            rebalance(at);
+        }
+
+        // the elements [pos, pos + n) as a chunk list that shares every chunk lying wholly in
+        // the range and copies the partial ones at its ends
+        chunk_list share_region(size_type pos, size_type n)
+        {
+            chunk_list out(alloc);
+            try
+            {
+                cursor at = locate(pos);
+                while (n != 0)
+                {
+                    chunk* c = at.leaf();
+                    size_type take = c->count - at.offset < n ? c->count - at.offset : n;
+                    out.reserve(out.size() + 1);
+                    if (take == c->count)
+                    {
+                        c->owners.fetch_add(1, std::memory_order_relaxed);
+                        out.push_back(c);
+                    }
+                    else
+                    {
+                        chunk* copy = allocate_chunk();
+                        out.push_back(copy);
+                        for (size_type j = 0; j < take; ++j)
+                        {
+                            construct(copy->slots + j, element(c, at.offset + j));
+                            copy->gap = ++copy->count;
+                        }
+                    }
+                    n -= take;
+                    next_chunk(at);
+                }
+            }
+            catch (...)
+            {
+                for (chunk* c : out)
+                {
+                    release_chunk(c);
+                }
+                throw;
+            }
+            return out;
+        }
+
+        // applies the edits [first, last), sorted by position, to the chunk at `at`, whose first
+        // element had index chunk_start before the batch. the survivors are relocated once into
+        // fresh, evenly filled chunks that take the old chunk's place; returns how many moved.
+        // if a move or an inserted value throws, the chunk's elements are lost and the history
+        // is discarded, but the container stays valid.
+        template <typename EditIt>
+        size_type rebuild_chunk(cursor at, size_type chunk_start, EditIt first, EditIt last)
+        {
+            chunk* c = own(at);
+            size_type inserts = 0;
+            for (EditIt e = first; e != last; ++e)
+            {
+                inserts += e->kind == edit::insert ? 1 : 0;
+            }
+            size_type erases = static_cast<size_type>(last - first) - inserts;
+            size_type n = c->count + inserts - erases;
+            size_type pieces = (n + ChunkSize - 1) / ChunkSize;
+
+            chunk_list out(alloc);
+            try
+            {
+                out.reserve(pieces);
+                while (out.size() < pieces)
+                {
+                    out.push_back(allocate_chunk());
+                }
+            }
+            catch (...)
+            {
+                for (chunk* x : out)
+                {
+                    retire_chunk(x);
+                }
+                throw;
+            }
+
+            size_type moves = 0;
+            size_type o = 0;
+            size_type piece = 0;
+            // the next free slot, spreading n elements evenly over the pieces
+            auto slot = [&]() -> T* {
+                if (out[piece]->count == n * (piece + 1) / pieces - n * piece / pieces)
+                {
+                    ++piece;
+                }
+                return out[piece]->slots + out[piece]->count;
+            };
+            auto filled = [&]() { out[piece]->gap = ++out[piece]->count; };
+
+            try
+            {
+                for (EditIt e = first; e != last; ++e)
+                {
+                    size_type offset = e->pos - chunk_start;
+                    for (; o < offset; ++o, ++moves)
+                    {
+                        relocate(&element(c, o), slot());
+                        filled();
+                    }
+                    if (e->kind == edit::erase)
+                    {
+                        assert(o == offset && o < c->count && "apply_edits erases an element twice or past the end");
+                        destroy(&element(c, o));
+                        ++o;
+                    }
+                    else
+                    {
+                        construct(slot(), std::move(e->value));
+                        filled();
+                    }
+                }
+                for (; o < c->count; ++o, ++moves)
+                {
+                    relocate(&element(c, o), slot());
+                    filled();
+                }
+            }
+            catch (...)
+            {
+                for (; o < c->count; ++o)
+                {
+                    destroy(&element(c, o));
+                }
+                size_type lost = c->count;
+                c->count = c->gap = 0;
+                shrink_counts(at.parent, at.slot, lost);
+                total_size -= lost;
+                drop_chunk(at);
+                for (chunk* x : out)
+                {
+                    destroy_elements(x);
+                    retire_chunk(x);
+                }
+                forget();
+                throw;
+            }
+
+            size_type old_count = c->count;
+            c->count = c->gap = 0;
+            total_size = total_size + inserts - erases;
+            if (pieces == 0)
+            {
+                shrink_counts(at.parent, at.slot, old_count);
+                drop_chunk(at);
+                return moves;
+            }
+
+            at.parent->children[at.slot] = out[0];
+            retire_chunk(c);
+            if (out[0]->count >= old_count)
+            {
+                grow_counts(at.parent, at.slot, out[0]->count - old_count);
+            }
+            else
+            {
+                shrink_counts(at.parent, at.slot, old_count - out[0]->count);
+            }
+            for (size_type k = 1; k < pieces; ++k)
+            {
+                at = link_child(at.parent, at.slot + 1, out[k], out[k]->count);
+                ++chunk_count;
+            }
+            return moves;
+        }
+
+        bool recording() const noexcept
+        {
+            return history && history->depth != 0 && !history->lost;
+        }
+
+        void free_steps(step_list& steps)
+        {
+            for (journal_step& step : steps)
+            {
+                for (chunk* c : step.held)
+                {
+                    release_chunk(c);
+                }
+            }
+            steps.clear();
+        }
+
+        // drops the whole history along with the elements it holds
+        void forget()
+        {
+            if (!history)
+            {
+                return;
+            }
+            free_steps(history->undo);
+            free_steps(history->redo);
+            if (history->depth == 0)
+            {
+                history.reset();
+                return;
+            }
+            // an open group stays open so its end_group() still balances; the rest of it
+            // records nothing
+            history->undo_marks.clear();
+            history->redo_marks.clear();
+            history->lost = true;
+        }
+
+        // starts a step of the open group; a new edit makes everything undone unrecoverable
+        journal_step& new_step(size_type pos)
+        {
+            if (!history->redo.empty())
+            {
+                free_steps(history->redo);
+                history->redo_marks.clear();
+            }
+            history->undo.emplace_back(alloc);
+            history->undo.back().pos = pos;
+            return history->undo.back();
+        }
+
+        // the last step of the open group, which an adjacent edit can extend
+        journal_step* open_step()
+        {
+            return history->undo.size() > history->undo_marks.back() ? &history->undo.back() : nullptr;
+        }
+
+        // records n elements inserted at pos. an insert inside or next to the region of the
+        // last step widens that region, so typing or pasting piecewise stays one step.
+        void note_insert(size_type pos, size_type n)
+        {
+            if (!history || n == 0)
+            {
+                return;
+            }
+            if (history->depth == 0 || history->lost)
+            {
+                forget();
+                return;
+            }
+
+            journal_step* step = open_step();
+            if (step && pos >= step->pos && pos <= step->pos + step->cut)
+            {
+                step->cut += n;
+                return;
+            }
+            new_step(pos).cut = n;
+        }
+
+        // records that e, the element at pos, is about to be erased by moving it into the
+        // history. erasing an element inserted by the last step just narrows its region.
+        void note_erase(size_type pos, T& e)
+        {
+            if (history->depth == 0 || history->lost)
+            {
+                forget();
+                return;
+            }
+
+            journal_step* step = open_step();
+            if (step && pos >= step->pos && pos < step->pos + step->cut)
+            {
+                --step->cut;
+            }
+            else if (step && pos == step->pos + step->cut)
+            {
+                hold_back(*step, e);
+            }
+            else if (step && pos + 1 == step->pos)
+            {
+                hold_front(*step, e);
+                --step->pos;
+            }
+            else
+            {
+                hold_back(new_step(pos), e);
+            }
+        }
+
+        // records that the elements [pos, pos + n) are about to be replaced by replaced_by others
+        void note_replace(size_type pos, size_type n, size_type replaced_by)
+        {
+            if (!history || (n == 0 && replaced_by == 0))
+            {
+                return;
+            }
+            if (history->depth == 0 || history->lost)
+            {
+                forget();
+                return;
+            }
+
+            journal_step& step = new_step(pos);
+            if (n != 0)
+            {
+                step.held = share_region(pos, n);
+            }
+            step.held_size = n;
+            step.cut = replaced_by;
+        }
+
+        // records the elements moved out into tail by split_off(pos); the history shares its
+        // chunks, so this costs a pointer per chunk
+        void note_split(size_type pos, const rope_vector& tail)
+        {
+            if (!history || tail.empty())
+            {
+                return;
+            }
+            if constexpr (std::is_copy_constructible<T>::value)
+            {
+                if (history->depth != 0 && !history->lost)
+                {
+                    journal_step& step = new_step(pos);
+                    step.held.reserve(tail.chunk_count);
+                    cursor at = tail.front_cursor();
+                    do
+                    {
+                        chunk* c = at.leaf();
+                        c->owners.fetch_add(1, std::memory_order_relaxed);
+                        step.held.push_back(c);
+                    } while (next_chunk(at));
+                    step.held_size = tail.total_size;
+                    return;
+                }
+            }
+            // move-only elements cannot be shared with the history, which is dropped instead
+            forget();
+        }
+
+        void hold_back(journal_step& step, T& e)
+        {
+            chunk* c = step.held.empty() ? nullptr : step.held.back();
+            if (!c || c->count == ChunkSize || c->owners.load(std::memory_order_acquire) != 1)
+            {
+                step.held.reserve(step.held.size() + 1);
+                c = allocate_chunk();
+                step.held.push_back(c);
+            }
+            close_gap(c);
+            construct(c->slots + c->count, std::move(e));
+            c->gap = ++c->count;
+            ++step.held_size;
+        }
+
+        void hold_front(journal_step& step, T& e)
+        {
+            chunk* c = step.held.empty() ? nullptr : step.held.front();
+            if (!c || c->count == ChunkSize || c->owners.load(std::memory_order_acquire) != 1)
+            {
+                step.held.reserve(step.held.size() + 1);
+                c = allocate_chunk();
+                step.held.insert(step.held.begin(), c);
+            }
+            move_gap(c, 0);
+            construct(c->slots + ChunkSize - c->count - 1, std::move(e));
+            ++c->count;
+            ++step.held_size;
+        }
+
+        // empties the container; inside a group the chunks move into the history instead
+        void drop_contents()
+        {
+            if (total_size == 0)
+            {
+                return;
+            }
+            if (recording())
+            {
+                journal_step& step = new_step(0);
+                step.held_size = total_size;
+                step.held = dismantle();
+                chunk_count = 0;
+                total_size = 0;
+                return;
+            }
+            forget();
+            release_all();
+        }
+
+        // reverts the newest group of from, last step first, and files it as the newest group of to
+        void replay(step_list& from, mark_list& from_marks, step_list& to, mark_list& to_marks)
+        {
+            size_type first = from_marks.back();
+            to.reserve(to.size() + from.size() - first);
+            to_marks.push_back(to.size());
+            while (from.size() > first)
+            {
+                journal_step& step = from.back();
+                chunk_list region = cut_chunks(step.pos, step.cut);
+                paste_chunks(step.pos, step.held);
+                std::swap(step.cut, step.held_size);
+                step.held = std::move(region);
+                to.push_back(std::move(step));
+                from.pop_back();
+            }
+            from_marks.pop_back();
+        }
+
+    public:
+        rope_vector() = default;
+
+        // chunks, the chunk tree and the spare list are all drawn from `allocator`
+        explicit rope_vector(const Allocator& allocator)
+            : alloc(allocator),
+            spare_chunks(rebind_alloc<chunk*>(allocator))
+        {
+        }
+
+        // copies share every chunk with other: O(chunks) work, no element is copied. each
+        // chunk is copied on the first write to it through either container, so references
+        // and iterators taken before the copy must not be used to write afterwards.
+        rope_vector(const rope_vector& other)
+            : alloc(alloc_traits::select_on_container_copy_construction(other.alloc)),
+            spare_chunks(rebind_alloc<chunk*>(alloc)),
+            spare_high_water(other.spare_high_water),
+            editing(other.editing)
+        {
+            share(other);
+        }
+
+        // move constructor
+        rope_vector(rope_vector&& other) noexcept
+            : alloc(std::move(other.alloc)),
+            root(other.root),
+            height(other.height),
+            chunk_count(other.chunk_count),
+            total_size(other.total_size),
+            spare_chunks(std::move(other.spare_chunks)),
+            spare_branches(other.spare_branches),
+            spare_branch_count(other.spare_branch_count),
+            spare_high_water(other.spare_high_water),
+            editing(other.editing),
+            history(std::move(other.history))
+        {
+            other.tail_branch = nullptr;
+            other.spare_branches = nullptr;
+            other.spare_branch_count = 0;
+            other.root = nullptr;
+            other.height = 0;
+            other.chunk_count = 0;
+            other.total_size = 0;
+        }
+
+        // move assignment
+        rope_vector& operator=(rope_vector&& other) noexcept(alloc_traits::propagate_on_container_move_assignment::value || alloc_traits::is_always_equal::value)
+        {
+            if (this == &other)
+            {
+                return *this;
+            }
+
+            forget();
+            release_all();
+            editing = other.editing;
+            if (alloc_traits::propagate_on_container_move_assignment::value || alloc == other.alloc)
+            {
+                // the cached blocks go back to the allocator they came from
+                trim();
+                if constexpr (alloc_traits::propagate_on_container_move_assignment::value)
+                {
+                    alloc = std::move(other.alloc);
+                }
+                root = other.root;
+                tail_branch = nullptr;
+                other.tail_branch = nullptr;
+                height = other.height;
+                chunk_count = other.chunk_count;
+                total_size = other.total_size;
+                spare_chunks = std::move(other.spare_chunks);
+                spare_branches = other.spare_branches;
+                spare_branch_count = other.spare_branch_count;
+                history = std::move(other.history);
+                other.spare_branches = nullptr;
+                other.spare_branch_count = 0;
+                other.root = nullptr;
+                other.height = 0;
+                other.chunk_count = 0;
+                other.total_size = 0;
+            }
+            else
+            {
+                // the chunks belong to another memory source, so the elements move one by one
+                other.forget();
+                while (!other.empty())
+                {
+                    emplace_back(std::move(other.front()));
+                    other.erase_front();
+                }
+            }
+            return *this;
+        }
+
+        rope_vector& operator=(const rope_vector& other)
+        {
+            if (this == &other)
+            {
+                return *this;
+            }
+
+            forget();
+            release_all();
+            if constexpr (alloc_traits::propagate_on_container_copy_assignment::value)
+            {
+                if (!(alloc == other.alloc))
+                {
+                    trim();
+                }
+                alloc = other.alloc;
+            }
+            editing = other.editing;
+            share(other);
+            return *this;
+        }
+
+        allocator_type get_allocator() const noexcept
+        {
+            return alloc;
+        }
+
+        size_type size() const noexcept
+        {
+            return total_size;
+        }
+
+        bool empty() const noexcept
+        {
+            return total_size == 0;
+        }
+
+        T& operator[](size_type i)
+        {
+            assert(i < total_size);
+            cursor at = locate(i);
+            return element(own(at), at.offset);
+        }
+
+        const T& operator[](size_type i) const
+        {
+            assert(i < total_size);
+            cursor at = locate(i);
+            return element(at.leaf(), at.offset);
+        }
+
+        T& at(size_type i)
+        {
+            assert(i < total_size && "rvec::at() index out of range");
+            return (*this)[i];
+        }
+
+        const T& at(size_type i) const
+        {
+            assert(i < total_size && "rvec::at() index out of range");
+            return (*this)[i];
+        }
+
+        T& front()
+        {
+            assert(!empty() && "rvec::front() called on empty vector");
+            return (*this)[0];
+        }
+
+        const T& front() const
+        {
+            assert(!empty() && "rvec::front() called on empty vector");
+            return (*this)[0];
+        }
+
+        T& back()
+        {
+            assert(!empty() && "rvec::back() called on empty vector");
+            return (*this)[total_size - 1];
+        }
+
+        const T& back() const
+        {
+            assert(!empty() && "rvec::back() called on empty vector");
+            return (*this)[total_size - 1];
+        }
+
+        // destroys all elements; up to spare_limit() chunks stay cached for reuse
+        void clear()
+        {
+            drop_contents();
+        }
+
+        // in editing mode every chunk keeps its gap where the last edit happened, so a run of
+        // inserts/erases at one spot costs O(1) moves each. leaving the mode packs all chunks.
+        void set_editing_mode(bool on)
+        {
+            if (editing && !on && root)
+            {
+                pack_gaps(root);
+            }
+            editing = on;
+        }
+
+        bool editing_mode() const noexcept
+        {
+            return editing;
+        }
+
+        void resize(size_type new_size)
+        {
+            if (recording() && new_size < total_size)
+            {
+                size_type n = total_size - new_size;
+                journal_step& step = new_step(new_size);
+                step.held = cut_chunks(new_size, n);
+                step.held_size = n;
+            }
+            else if (history && new_size < total_size)
+            {
+                forget();
+            }
+
+            // shrinking drops whole chunks from the back and trims the last one
+            while (total_size > new_size)
+            {
+                cursor last = back_cursor();
+                chunk* c = own(last);
+                size_type drop = c->count < total_size - new_size ? c->count : total_size - new_size;
+                close_gap(c);
+                for (size_type j = c->count - drop; j < c->count; ++j)
+                {
+                    destroy(c->slots + j);
+                }
+                c->count -= drop;
+                c->gap = c->count;
+                shrink_counts(last.parent, last.slot, drop);
+                total_size -= drop;
+                if (c->count == 0)
+                {
+                    drop_chunk(last);
+                }
+            }
+
+            while (total_size < new_size)
+            {
+                emplace_back();
+            }
+        }
+
+        // ensures appending up to n elements in total needs no further chunk allocation
+        void reserve(size_type n)
+        {
+            while (n > capacity())
+            {
+                park_new_chunk();
+            }
+        }
+
+        // returns how many elements can be stored by appending without growing
+        size_type capacity() const noexcept
+        {
+            size_type tail_room = root ? ChunkSize - back_cursor().offset : 0;
+            return total_size + tail_room + spare_chunks.size() * ChunkSize;
+        }
+
+        // raw, writable slots at the end of the container, handed out by append_span()
+        class write_span
+        {
+        public:
+            T* data() const noexcept
+            {
+                return first;
+            }
+
+            size_type size() const noexcept
+            {
+                return length;
+            }
+
+            T* begin() const noexcept
+            {
+                return first;
+            }
+
+            T* end() const noexcept
+            {
+                return first + length;
+            }
+
+        private:
+            friend class rope_vector;
+
+            T* first;
+            size_type length;
+
+            write_span(T* data, size_type n)
+                : first(data), length(n)
+            {
+            }
+        };
+
+        // returns up to max_n free slots after the last element for a producer such as read(),
+        // recv() or a decoder to write into directly. the span never crosses a chunk, so it is
+        // shorter than max_n when the tail chunk has less room; a full tail gets a fresh chunk,
+        // which joins the container only on commit(). nothing else may modify the container
+        // until then. only trivially copyable elements can be written into raw storage.
+        write_span append_span(size_type max_n)
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "rvec::rope_vector::append_span() needs trivially copyable elements");
+            if (root)
+            {
+                cursor at = back_cursor();
+                if (at.offset != ChunkSize)
+                {
+                    chunk* c = own(at);
+                    close_gap(c);
+                    size_type room = ChunkSize - c->count;
+                    return write_span(c->slots + c->count, max_n < room ? max_n : room);
+                }
+            }
+
+            // the next chunk is parked at the back of the spare list, where grow_back() takes it
+            if (spare_chunks.empty())
+            {
+                park_new_chunk();
+            }
+            return write_span(spare_chunks.back()->slots, max_n < ChunkSize ? max_n : ChunkSize);
+        }
+
+        // publishes the first n elements written into the span of the last append_span()
+        void commit(size_type n)
+        {
+            if (n == 0)
+            {
+                return;
+            }
+
+            cursor at = append_cursor();
+            chunk* c = at.leaf();
+            assert(c->count + n <= ChunkSize && "rvec::rope_vector::commit() past the span");
+            c->count += n;
+            c->gap = c->count;
+            grow_counts(at.parent, at.slot, n);
+            total_size += n;
+            note_insert(total_size - n, n);
+        }
+
+        // constructs the elements of one fresh chunk in place, in index order
+        class chunk_writer
+        {
+        public:
+            template <typename... Args>
+            void emplace(Args&&... args)
+            {
+                assert(c->count < length && "rvec::rope_vector::chunk_writer overfilled");
+                owner->construct(c->slots + c->count, std::forward<Args>(args)...);
+                c->gap = ++c->count;
+            }
+
+            // container index of the next element
+            size_type index() const noexcept
+            {
+                return first + c->count;
+            }
+
+            size_type remaining() const noexcept
+            {
+                return length - c->count;
+            }
+
+        private:
+            friend class rope_vector;
+
+            rope_vector* owner;
+            chunk* c;
+            size_type first;
+            size_type length;
+
+            chunk_writer(rope_vector* rv, chunk* target, size_type index, size_type n)
+                : owner(rv), c(target), first(index), length(n)
+            {
+            }
+        };
+
+        // replaces the contents with [first, last); forward ranges are built straight into
+        // fresh, full chunks
+        template <typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+        void assign(InputIt first, InputIt last)
+        {
+            using category = typename std::iterator_traits<InputIt>::iterator_category;
+            if constexpr (std::is_base_of<std::forward_iterator_tag, category>::value)
+            {
+                size_type n = static_cast<size_type>(std::distance(first, last));
+                assign_built(n, [&first](size_type chunks, auto writer) {
+                    for (size_type i = 0; i < chunks; ++i)
+                    {
+                        chunk_writer w = writer(i);
+                        for (size_type k = w.remaining(); k != 0; --k, ++first)
+                        {
+                            w.emplace(*first);
+                        }
+                    }
+                });
+            }
+            else
+            {
+                clear();
+                insert(0, first, last);
+            }
+        }
+
+        // replaces the contents with n elements built straight into fresh, full chunks.
+        // build(chunks, writer) must fill every chunk i < chunks through writer(i), a
+        // chunk_writer expecting exactly its remaining() elements. different chunks may be
+        // filled from different threads; nothing else may touch the container meanwhile.
+        template <typename Build>
+        void assign_built(size_type n, Build build)
+        {
+            drop_contents();
+            size_type chunks = (n + ChunkSize - 1) / ChunkSize;
+            chunk_list leaves(alloc);
+            leaves.reserve(chunks);
+            auto writer = [this, &leaves, n](size_type i)
+            {
+                size_type index = i * ChunkSize;
+                return chunk_writer(this, leaves[i], index, n - index < ChunkSize ? n - index : ChunkSize);
+            };
+            try
+            {
+                for (size_type i = 0; i < chunks; ++i)
+                {
+                    chunk* c = allocate_chunk();
+                    c->count = 0;
+                    c->gap = 0;
+                    leaves.push_back(c);
+                }
+                build(chunks, writer);
+            }
+            catch (...)
+            {
+                for (chunk* c : leaves)
+                {
+                    destroy_elements(c);
+                    retire_chunk(c);
+                }
+                throw;
+            }
+
+            assert(n == 0 || leaves.back()->count == n - (chunks - 1) * ChunkSize);
+            relink(leaves, n);
+            note_insert(0, n);
+        }
+
+        // how many retired chunks (and branches) are cached for reuse instead of being freed.
+        // a queue that retires one chunk per chunk it fills runs without allocator calls.
+        void set_spare_limit(size_type n)
+        {
+            spare_high_water = n;
+            while (spare_chunks.size() > n)
+            {
+                free_chunk(spare_chunks.back());
+                spare_chunks.pop_back();
+            }
+            while (spare_branch_count > n)
+            {
+                branch* b = spare_branches;
+                spare_branches = b->parent;
+                --spare_branch_count;
+                free_branch(b);
+            }
+        }
+
+        size_type spare_limit() const noexcept
+        {
+            return spare_high_water;
+        }
+
+        // gives this container a private copy of every chunk it shares with a copy. writes copy
+        // shared chunks lazily, one at a time; parallel algorithms call this first so that
+        // workers writing to different chunks never allocate.
+        void unshare()
+        {
+            if (!root)
+            {
+                return;
+            }
+
+            cursor at = front_cursor();
+            do
+            {
+                own(at);
+            } while (next_chunk(at));
+        }
+
+        // returns every cached chunk and branch to the allocator
+        void trim()
+        {
+            size_type limit = spare_high_water;
+            set_spare_limit(0);
+            spare_high_water = limit;
+        }
+
+        // releases spare chunks and repacks partially filled ones so every chunk but the last is full
+        void shrink_to_fit()
+        {
+            trim();
+
+            if (chunk_count * ChunkSize - total_size < ChunkSize)
+            {
+                return;
+            }
+
+            // pour everything into full chunks; drained chunks are reused as destinations.
+            // a source is always drained by the time a second destination is needed, so the
+            // one fresh chunk and the bookkeeping are allocated before the tree comes apart.
+            unshare();
+            chunk* fresh = allocate_chunk();
+            chunk_list leaves(alloc);
+            chunk_list packed(alloc);
+            chunk_list drained(alloc);
+            try
+            {
+                packed.reserve(chunk_count);
+                drained.reserve(chunk_count);
+                leaves = dismantle();
+            }
+            catch (...)
+            {
+                retire_chunk(fresh);
+                throw;
+            }
+            chunk* out = nullptr;
+            for (chunk* src : leaves)
+            {
+                close_gap(src);
+                for (size_type j = 0; j < src->count;)
+                {
+                    if (!out || out->count == ChunkSize)
+                    {
+                        if (drained.empty())
+                        {
+                            assert(fresh && "shrink_to_fit() needs one fresh chunk at most");
+                            out = fresh;
+                            fresh = nullptr;
+                        }
+                        else
+                        {
+                            out = drained.back();
+                            drained.pop_back();
+                        }
+                        packed.push_back(out);
+                    }
+                    size_type room = ChunkSize - out->count;
+                    size_type n = src->count - j < room ? src->count - j : room;
+                    shift_slots(src->slots + j, n, out->slots + out->count);
+                    out->count += n;
+                    out->gap = out->count;
+                    j += n;
+                }
+                src->count = src->gap = 0;
+                drained.push_back(src);
+            }
+
+            for (chunk* c : drained)
+            {
+                free_chunk(c);
+            }
+            if (fresh)
+            {
+                retire_chunk(fresh);
+            }
+            relink(packed, total_size);
+        }
+
+        void push_back(const T& value)
+        {
+            emplace_back(value);
+        }
+
+        void push_back(T&& value)
+        {
+            emplace_back(std::move(value));
+        }
+
+        // the common append is a few compares, one construct and one count bump per level of
+        // the rightmost path; the last chunk's parent is cached until the tree is reshaped.
+        // a full, shared or gapped tail, or an unknown one, takes the out-of-line path.
+        template <typename... Args>
+        void emplace_back(Args&&... args)
+        {
+            if (tail_branch)
+            {
+                chunk* c = static_cast<chunk*>(tail_branch->children[tail_branch->size - 1]);
+                if (c->gap == c->count && c->count != ChunkSize && c->owners.load(std::memory_order_acquire) == 1)
+                {
+                    construct(c->slots + c->count, std::forward<Args>(args)...);
+                    c->gap = ++c->count;
+                    for (branch* b = tail_branch; b; b = b->parent)
+                    {
+                        ++b->counts[b->size - 1];
+                    }
+                    ++total_size;
+                    if (history)
+                    {
+                        note_insert(total_size - 1, 1);
+                    }
+                    return;
+                }
+            }
+            emplace_back_slow(std::forward<Args>(args)...);
+        }
+
+        // appends the n elements at data, filling the tail chunk and then fresh ones a whole
+        // chunk at a time; trivially copyable elements are copied with one memcpy per chunk.
+        // if a copy throws, the elements copied before it stay appended.
+        void append_n(const T* data, size_type n)
+        {
+            while (n != 0)
+            {
+                cursor at = append_cursor();
+                chunk* c = at.leaf();
+                size_type take = ChunkSize - c->count < n ? ChunkSize - c->count : n;
+                size_type made = 0;
+                auto publish = [&]()
+                {
+                    c->count += made;
+                    c->gap = c->count;
+                    grow_counts(at.parent, at.slot, made);
+                    total_size += made;
+                    note_insert(total_size - made, made);
+                };
+
+                if constexpr (std::is_trivially_copyable<T>::value)
+                {
+                    std::memcpy(static_cast<void*>(c->slots + c->count), static_cast<const void*>(data), take * sizeof(T));
+                    made = take;
+                }
+                else
+                {
+                    try
+                    {
+                        for (; made < take; ++made)
+                        {
+                            construct(c->slots + c->count + made, data[made]);
+                        }
+                    }
+                    catch (...)
+                    {
+                        publish();
+                        throw;
+                    }
+                }
+                publish();
+                data += take;
+                n -= take;
+            }
+        }
+
+        void insert(size_type pos, const T& value)
+        {
+            // copied first, since value may be an element the insert is about to move
+            emplace(pos, T(value));
+        }
+
+        void insert(size_type pos, T&& value)
+        {
+            emplace(pos, std::move(value));
+        }
+
+        // inserts count copies of value before pos, making room once
+        void insert(size_type pos, size_type count, const T& value)
+        {
+            if (count == 0)
+            {
+                return;
+            }
+            const T copy(value);
+            insert_made(pos, count, [this, &copy](T* slot) { construct(slot, copy); });
+        }
+
+        // inserts [first, last) before pos. with forward iterators the room is made once, in the
+        // chunk at pos if the range fits there and as fresh chunks linked in otherwise, so no
+        // existing element moves more than once; single-pass input is gathered into chunks
+        // first and linked in the same way.
+        template <typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+        void insert(size_type pos, InputIt first, InputIt last)
+        {
+            using category = typename std::iterator_traits<InputIt>::iterator_category;
+            if constexpr (std::is_base_of<std::forward_iterator_tag, category>::value)
+            {
+                size_type n = static_cast<size_type>(std::distance(first, last));
+                insert_made(pos, n, [this, &first](T* slot) {
+                    construct(slot, *first);
+                    ++first;
+                });
+            }
+            else
+            {
+                assert(pos <= total_size && "insert position out of bounds");
+                rope_vector gathered(alloc);
+                for (; first != last; ++first)
+                {
+                    gathered.emplace_back(*first);
+                }
+                size_type n = gathered.total_size;
+                chunk_list leaves = gathered.dismantle();
+                gathered.chunk_count = 0;
+                gathered.total_size = 0;
+                paste_chunks(pos, leaves);
+                note_insert(pos, n);
+            }
+        }
+
+        // constructs an element from args directly in its slot before pos. args must not refer
+        // to elements of the container, which the insert may move.
+        template <typename... Args>
+        void emplace(size_type pos, Args&&... args)
+        {
+            assert(pos <= total_size);
+            if (!root)
+            {
+                emplace_back(std::forward<Args>(args)...);
+                return;
+            }
+
+            cursor at = locate_insert(pos);
+            if (at.leaf()->count == ChunkSize)
+            {
+                at = split_for_insert(at);
+            }
+
+            // only one chunk moves: its tail, or in editing mode just the span up to the gap
+            chunk* c = own(at);
+            if (at.offset == 0)
+            {
+                // prepends fill the chunk from the right, leaving headroom at the front
+                move_gap(c, 0);
+                construct(c->slots + ChunkSize - c->count - 1, std::forward<Args>(args)...);
+                ++c->count;
+            }
+            else if (editing)
+            {
+                move_gap(c, at.offset);
+                construct(c->slots + at.offset, std::forward<Args>(args)...);
+                ++c->count;
+                ++c->gap;
+            }
+            else
+            {
+                // built aside before the tail moves, so a throwing constructor leaves every
+                // element where it was
+                alignas(T) unsigned char aside[sizeof(T)];
+                T* made = reinterpret_cast<T*>(aside);
+                construct(made, std::forward<Args>(args)...);
+                try
+                {
+                    close_gap(c);
+                    shift_slots(c->slots + at.offset, c->count - at.offset, c->slots + at.offset + 1);
+                    relocate(made, c->slots + at.offset);
+                }
+                catch (...)
+                {
+                    destroy(made);
+                    throw;
+                }
+                ++c->count;
+                ++c->gap;
+            }
+            grow_counts(at.parent, at.slot, 1);
+            ++total_size;
+            note_insert(pos, 1);
+        }
+
+        void erase(size_type pos)
+        {
+            assert(pos < total_size && "erase position out of bounds");
+
+            cursor at = locate(pos);
+            if (history)
+            {
+                note_erase(pos, element(own(at), at.offset));
+            }
+            erase_in_chunk(at, 1);
+        }
+
+        // erases [first, last). a range inside one chunk joins that chunk's gap; a longer one
+        // unlinks the chunks it covers whole, so only the chunks at its two ends move
+        // elements. inside a group the erased chunks move into the history as they are.
+        void erase(size_type first, size_type last)
+        {
+            assert(first <= last && last <= total_size && "erase range out of bounds");
+            size_type n = last - first;
+            if (n == 0)
+            {
+                return;
+            }
+            if (recording())
+            {
+                journal_step& step = new_step(first);
+                step.held = cut_chunks(first, n);
+                step.held_size = n;
+                return;
+            }
+            else if (history)
+            {
+                forget();
+            }
+
+            cursor at = locate(first);
+            if (at.offset + n <= at.leaf()->count)
+            {
+                erase_in_chunk(at, n);
+                return;
+            }
+            for (chunk* c : cut_chunks(first, n))
+            {
+                release_chunk(c);
+            }
+        }
+
+        // pops the first element in O(1) moves: the front chunk keeps its gap at offset 0 and
+        // is released once it drains, so a FIFO only ever holds the chunks it is using
+        void erase_front()
+        {
+            assert(!empty());
+
+            cursor at = front_cursor();
+            chunk* c = own(at);
+            if (history)
+            {
+                note_erase(0, element(c, 0));
+            }
+            move_gap(c, 0);
+            destroy(c->slots + ChunkSize - c->count);
+            --c->count;
+            shrink_counts(at.parent, at.slot, 1);
+            --total_size;
+            if (c->count == 0)
+            {
+                drop_chunk(at);
+            }
+        }
+
+        // moves every element of other to the end by relinking its chunks under this tree. the
+        // two chunks meeting at the seam are combined when they fit in one; nothing else moves.
+        // with unequal allocators the elements are moved one by one instead.
+        void append(rope_vector&& other)
+        {
+            assert(this != &other && "rvec::rope_vector::append() of itself");
+            if (other.empty())
+            {
+                return;
+            }
+            other.forget();
+            if (!(alloc == other.alloc))
+            {
+                while (!other.empty())
+                {
+                    emplace_back(std::move(other.front()));
+                    other.erase_front();
+                }
+                return;
+            }
+
+            // room for both sides is taken before either tree comes apart
+            chunk_list leaves(alloc);
+            leaves.reserve(chunk_count + other.chunk_count);
+            dismantle(leaves);
+            size_type seam = leaves.size();
+            other.dismantle(leaves);
+            if (seam != 0 && leaves[seam - 1]->count + leaves[seam]->count <= ChunkSize && leaves[seam - 1]->owners.load(std::memory_order_acquire) == 1 && leaves[seam]->owners.load(std::memory_order_acquire) == 1)
+            {
+                chunk* back = leaves[seam - 1];
+                chunk* front = leaves[seam];
+                close_gap(back);
+                close_gap(front);
+                shift_slots(front->slots, front->count, back->slots + back->count);
+                back->count += front->count;
+                back->gap = back->count;
+                front->count = front->gap = 0;
+                retire_chunk(front);
+                leaves.erase(leaves.begin() + static_cast<std::ptrdiff_t>(seam));
+            }
+
+            size_type pos = total_size;
+            size_type n = total_size + other.total_size;
+            other.chunk_count = 0;
+            other.total_size = 0;
+            relink(leaves, n);
+            note_insert(pos, n - pos);
+        }
+
+        // inserts every element of other before pos; the container is cut at pos, other's chunks
+        // are relinked after the head and the tail's after them
+        void splice(size_type pos, rope_vector&& other)
+        {
+            assert(pos <= total_size && "splice position out of bounds");
+            if (pos == total_size)
+            {
+                append(std::move(other));
+                return;
+            }
+
+            // the three pieces are recorded as the one insert they add up to
+            size_type n = other.size();
+            journal_ptr kept = std::move(history);
+            try
+            {
+                rope_vector tail = split_off(pos);
+                append(std::move(other));
+                append(std::move(tail));
+            }
+            catch (...)
+            {
+                history = std::move(kept);
+                forget();
+                throw;
+            }
+            history = std::move(kept);
+            note_insert(pos, n);
+        }
+
+        // removes [pos, size()) and returns it as a container with the same allocator, editing
+        // mode and spare limit. whole chunks change owner; only the chunk holding pos is split.
+        rope_vector split_off(size_type pos)
+        {
+            assert(pos <= total_size && "split position out of bounds");
+            rope_vector tail(alloc);
+            tail.editing = editing;
+            tail.spare_high_water = spare_high_water;
+            if (pos == total_size)
+            {
+                return tail;
+            }
+
+            // everything the split allocates is taken while the tree is intact: the chunk
+            // straddling pos is unshared in place, and the fresh chunk for its rest waits in
+            // the tail's spare cache
+            chunk* straddle = nullptr;
+            if (pos != 0)
+            {
+                cursor at = locate(pos);
+                if (at.offset != 0)
+                {
+                    straddle = own(at);
+                    tail.park_new_chunk();
+                }
+            }
+            chunk_list moved(alloc);
+            moved.reserve(chunk_count + 1);
+            chunk_list leaves = dismantle();
+            chunk* right = straddle ? tail.allocate_chunk() : nullptr;
+            size_type k = 0;
+            size_type start = 0;
+            while (start + leaves[k]->count <= pos)
+            {
+                start += leaves[k]->count;
+                ++k;
+            }
+
+            if (right)
+            {
+                // the chunk straddling pos keeps its head and hands its rest to a fresh chunk
+                chunk* c = leaves[k];
+                assert(c == straddle);
+                size_type offset = pos - start;
+                close_gap(c);
+                shift_slots(c->slots + offset, c->count - offset, right->slots);
+                right->count = right->gap = c->count - offset;
+                c->count = c->gap = offset;
+                moved.push_back(right);
+                ++k;
+            }
+            moved.insert(moved.end(), leaves.begin() + k, leaves.end());
+            leaves.resize(k);
+
+            try
+            {
+                tail.relink(moved, total_size - pos);
+            }
+            catch (...)
+            {
+                drop_detached(leaves);
+                throw;
+            }
+            relink(leaves, pos);
+            note_split(pos, tail);
+            return tail;
+        }
+
+        // overwrites [pos, pos + distance(first, last)) with the range. inside a group the old
+        // values are recorded as references to the chunks holding them, so only the partial
+        // chunks at the ends of the region are copied into the history.
+        template <typename ForwardIt>
+        void replace(size_type pos, ForwardIt first, ForwardIt last)
+        {
+            size_type n = static_cast<size_type>(std::distance(first, last));
+            assert(pos + n <= total_size && "replace range out of bounds");
+            if constexpr (std::is_copy_constructible<T>::value)
+            {
+                note_replace(pos, n, n);
+            }
+            else if (history)
+            {
+                forget();
+            }
+
+            for (run_walker<T*> w = runs(pos); first != last; w.advance(1), ++first)
+            {
+                *w.data() = *first;
+            }
+        }
+
+        // one change of an apply_edits() batch. positions index the sequence as it was before
+        // the batch: an insert puts value before the element at pos (pos == size() appends) and
+        // an erase removes the element at pos.
+        struct edit
+        {
+            enum kind_type : unsigned char
+            {
+                insert,
+                erase
+            };
+
+            kind_type kind = insert;
+            size_type pos = 0;
+            T value{}; // the inserted element; unused by erases
+        };
+
+        // applies a batch of edits in one left-to-right pass. the edits are stably sorted by
+        // position, so inserts at the same position keep their order, and each chunk they touch
+        // is rebuilt once: every element in it is moved at most once however many edits land
+        // there, and untouched chunks are not visited. inserted values are moved out of the
+        // edits. an element may be erased at most once. inside a group the batch is recorded
+        // as a single step. returns the number of existing elements moved.
+        template <typename RandomIt>
+        size_type apply_edits(RandomIt first, RandomIt last)
+        {
+            if (first == last)
+            {
+                return 0;
+            }
+
+            std::stable_sort(first, last, [](const edit& a, const edit& b) { return a.pos < b.pos; });
+            size_type inserts = 0;
+            size_type region_end = 0;
+            for (RandomIt e = first; e != last; ++e)
+            {
+                assert(e->pos + (e->kind == edit::erase ? 1 : 0) <= total_size && "apply_edits position out of bounds");
+                inserts += e->kind == edit::insert ? 1 : 0;
+                region_end = std::max(region_end, e->pos + (e->kind == edit::erase ? 1 : 0));
+            }
+            size_type erases = static_cast<size_type>(last - first) - inserts;
+            size_type region = region_end - first->pos;
+            if constexpr (std::is_copy_constructible<T>::value)
+            {
+                note_replace(first->pos, region, region + inserts - erases);
+            }
+            else if (history)
+            {
+                forget();
+            }
+
+            if (!root)
+            {
+                try
+                {
+                    root = allocate_branch(true);
+                    height = 1;
+                    link_child(root, 0, allocate_chunk(), 0);
+                    ++chunk_count;
+                }
+                catch (...)
+                {
+                    release_all();
+                    forget();
+                    throw;
+                }
+            }
+
+            // old + shift is where an old index sits now that the earlier chunks are rebuilt
+            size_type moves = 0;
+            size_type shift_up = 0;
+            size_type shift_down = 0;
+            for (RandomIt e = first; e != last;)
+            {
+                size_type at_now = e->pos + shift_up - shift_down;
+                cursor at = at_now < total_size ? locate(at_now) : back_cursor();
+                size_type count = at.leaf()->count;
+                size_type chunk_start = e->pos - at.offset;
+                bool last_chunk = at_now - at.offset + count == total_size;
+
+                RandomIt group = e;
+                for (; e != last && (e->pos < chunk_start + count || (last_chunk && e->pos == chunk_start + count)); ++e)
+                {
+                    if (e->kind == edit::insert)
+                    {
+                        ++shift_up;
+                    }
+                    else
+                    {
+                        ++shift_down;
+                    }
+                }
+                moves += rebuild_chunk(at, chunk_start, group, e);
+            }
+            return moves;
+        }
+
+        // applies every edit held by a container of edits, see apply_edits(first, last)
+        template <typename Edits>
+        size_type apply_edits(Edits& edits)
+        {
+            return apply_edits(std::begin(edits), std::end(edits));
+        }
+
+        // opens an undo group; groups nest and the outermost end_group() closes it. inside a
+        // group insert, erase, erase_front, push_back, resize, clear, append, splice, split_off
+        // and replace are recorded as the inverse edits. writes through references, iterators
+        // or the bulk algorithms are not, and any recorded kind of edit made outside a group
+        // discards the history.
+        void begin_group()
+        {
+            if (!history)
+            {
+                rebind_alloc<journal> a(alloc);
+                journal* j = rebind_traits<journal>::allocate(a, 1);
+                try
+                {
+                    rebind_traits<journal>::construct(a, j, alloc);
+                }
+                catch (...)
+                {
+                    rebind_traits<journal>::deallocate(a, j, 1);
+                    throw;
+                }
+                history = journal_ptr(j, journal_deleter{ a });
+            }
+            if (history->depth++ == 0)
+            {
+                history->undo_marks.push_back(history->undo.size());
+            }
+        }
+
+        void end_group()
+        {
+            assert(history && history->depth != 0 && "rvec::end_group() without begin_group()");
+            if (--history->depth != 0)
+            {
+                return;
+            }
+            if (history->lost)
+            {
+                history.reset();
+            }
+            else if (history->undo.size() == history->undo_marks.back())
+            {
+                // a group that changed nothing leaves nothing to undo
+                history->undo_marks.pop_back();
+            }
+        }
+
+        // reverts the newest closed group in O(log n) per chunk it touches; false when there
+        // is nothing to undo
+        bool undo()
+        {
+            assert((!history || history->depth == 0) && "rvec::undo() inside an open group");
+            if (!can_undo())
+            {
+                return false;
+            }
+            replay(history->undo, history->undo_marks, history->redo, history->redo_marks);
+            return true;
+        }
+
+        // reapplies the newest undone group; any recorded edit since the undo discards it
+        bool redo()
+        {
+            assert((!history || history->depth == 0) && "rvec::redo() inside an open group");
+            if (!can_redo())
+            {
+                return false;
+            }
+            replay(history->redo, history->redo_marks, history->undo, history->undo_marks);
+            return true;
+        }
+
+        bool can_undo() const noexcept
+        {
+            return history && history->depth == 0 && !history->undo_marks.empty();
+        }
+
+        bool can_redo() const noexcept
+        {
+            return history && history->depth == 0 && !history->redo_marks.empty();
+        }
+
+        // frees the undo and redo history
+        void discard_history()
+        {
+            assert((!history || history->depth == 0) && "rvec::discard_history() inside an open group");
+            forget();
+        }
+
+        // calls f(T* data, size_t n) for every contiguous run of elements, in order. each chunk is
+        // one run, or two while it holds an editing gap. if f returns bool, false stops the walk.
+        template <typename F>
+        void for_each_chunk(F&& f)
+        {
+            visit_runs<T*>(f);
+        }
+
+        template <typename F>
+        void for_each_chunk(F&& f) const
+        {
+            visit_runs<const T*>(f);
+        }
+
+        // walks the contiguous runs of elements from a starting index. data()/size() describe
+        // the rest of the current run and advance(n) consumes n elements of it, stepping to the
+        // next run once it is used up. walkers over two containers advanced in lockstep by the
+        // shorter of their runs split the work at both containers' seams.
+        template <typename Ptr>
+        class run_walker
+        {
+        public:
+            run_walker() = default;
+
+            Ptr data() const noexcept
+            {
+                return first;
+            }
+
+            size_type size() const noexcept
+            {
+                return length;
+            }
+
+            // elements left in the whole walk, including the current run
+            size_type remaining() const noexcept
+            {
+                return left;
+            }
+
+            bool done() const noexcept
+            {
+                return left == 0;
+            }
+
+            void advance(size_type n)
+            {
+                assert(n <= length);
+                left -= n;
+                first += n;
+                length -= n;
+                at.offset += n;
+                if (length == 0 && left != 0)
+                {
+                    if (at.offset == at.leaf()->count)
+                    {
+                        next_chunk(at);
+                    }
+                    seat();
+                }
+            }
+
+        private:
+            friend class rope_vector;
+
+            const rope_vector* owner = nullptr;
+            cursor at;
+            size_type left = 0;
+            Ptr first = nullptr;
+            size_type length = 0;
+
+            run_walker(const rope_vector* rv, size_type i)
+                : owner(rv),
+                left(rv->total_size - i)
+            {
+                if (left != 0)
+                {
+                    at = rv->locate(i);
+                    seat();
+                }
+            }
 
-            for (size_type i = pos; i < total_size - 1; ++i)
+            void seat()
             {
-                (*this)[i] = std::move((*this)[i + 1]);
+                chunk* c = at.leaf();
+                if constexpr (!std::is_const<std::remove_pointer_t<Ptr>>::value)
+                {
+                    c = const_cast<rope_vector*>(owner)->own(at);
+                }
+                first = &element(c, at.offset);
+                length = (at.offset < c->gap ? c->gap : c->count) - at.offset;
             }
+        };
 
-            --total_size;
+        run_walker<T*> runs(size_type from = 0)
+        {
+            assert(from <= total_size);
+            return run_walker<T*>(this, from);
         }
 
-        void erase_front()
+        run_walker<const T*> runs(size_type from = 0) const
         {
-            assert(!empty());
+            assert(from <= total_size);
+            return run_walker<const T*>(this, from);
+        }
 
-            ++start_index;
-            --total_size;
+        // one past the index of the last element in the chunk holding element i, i.e. the
+        // next chunk seam after i
+        size_type chunk_end(size_type i) const
+        {
+            assert(i < total_size && "chunk_end index out of bounds");
+            cursor at = locate(i);
+            return i - at.offset + at.leaf()->count;
+        }
 
-            if (start_index >= ChunkSize)
-            {
-                free_chunk(chunks[front_chunk_index]);
-                ++front_chunk_index;
-                start_index -= ChunkSize;
-            }
+        // read-only runs of a non-const container; unlike runs() they never copy shared chunks
+        run_walker<const T*> cruns(size_type from = 0) const
+        {
+            return runs(from);
         }
 
         bool operator==(const rope_vector& other) const
@@ -333,12 +3214,34 @@ namespace rvec
                 return false;
             }
 
-            for (size_type i = 0; i < total_size; ++i)
+            // walk both chunk sequences run by run; their seams need not line up
+            run_walker<const T*> a = runs();
+            run_walker<const T*> b = other.runs();
+            while (!a.done())
             {
-                if ((*this)[i] != other[i])
+                size_type n = a.size() < b.size() ? a.size() : b.size();
+                const T* x = a.data();
+                const T* y = b.data();
+                if constexpr (std::has_unique_object_representations<T>::value)
                 {
-                    return false;
+                    if (std::memcmp(x, y, n * sizeof(T)) != 0)
+                    {
+                        return false;
+                    }
                 }
+                else
+                {
+                    for (size_type j = 0; j < n; ++j)
+                    {
+                        if (x[j] != y[j])
+                        {
+                            return false;
+                        }
+                    }
+                }
+
+                a.advance(n);
+                b.advance(n);
             }
 
             return true;
@@ -349,15 +3252,37 @@ namespace rvec
             return !(*this == other);
         }
 
+        // allocators that do not propagate on swap must compare equal. the undo history, open
+        // groups included, travels with the contents it describes: after the swap each
+        // container undoes and closes groups for the elements it now holds.
         void swap(rope_vector& other) noexcept
         {
-            chunks.swap(other.chunks);
+            if constexpr (alloc_traits::propagate_on_container_swap::value)
+            {
+                std::swap(alloc, other.alloc);
+            }
+            else
+            {
+                assert(alloc == other.alloc && "rvec::swap() needs equal allocators");
+            }
+            std::swap(root, other.root);
+            std::swap(tail_branch, other.tail_branch);
+            std::swap(height, other.height);
+            std::swap(chunk_count, other.chunk_count);
             std::swap(total_size, other.total_size);
-            std::swap(start_index, other.start_index);
-            std::swap(front_chunk_index, other.front_chunk_index);
+            spare_chunks.swap(other.spare_chunks);
+            std::swap(spare_branches, other.spare_branches);
+            std::swap(spare_branch_count, other.spare_branch_count);
+            std::swap(spare_high_water, other.spare_high_water);
+            std::swap(editing, other.editing);
+            history.swap(other.history);
         }
 
+        class const_iterator;
 
+        // iterators cache the contiguous run of slots they are in, so stepping is a pointer
+        // increment; the chunk tree is only consulted when a step leaves the run. jumps that
+        // stay inside the run are pointer arithmetic, longer ones descend the tree once.
         class iterator
         {
         public:
@@ -368,8 +3293,18 @@ namespace rvec
             using reference = T&;
 
         private:
+            friend class const_iterator;
+
             rope_vector* parent = nullptr;
             size_type index = 0;
+            T* cur = nullptr;
+            T* first = nullptr; // bounds of the run holding cur
+            T* last = nullptr;
+
+            void seat()
+            {
+                parent->seat_owned_run(index, cur, first, last);
+            }
 
         public:
             iterator() = default;
@@ -377,21 +3312,26 @@ namespace rvec
             iterator(rope_vector* rv, size_type i)
                 : parent(rv), index(i)
             {
+                seat();
             }
 
             reference operator*() const
             {
-                return (*parent)[index];
+                return *cur;
             }
 
             pointer operator->() const
             {
-                return &(*parent)[index];
+                return cur;
             }
 
             iterator& operator++()
             {
                 ++index;
+                if (++cur == last)
+                {
+                    seat();
+                }
                 return *this;
             }
 
@@ -405,6 +3345,14 @@ namespace rvec
             iterator& operator--()
             {
                 --index;
+                if (cur == first)
+                {
+                    seat();
+                }
+                else
+                {
+                    --cur;
+                }
                 return *this;
             }
 
@@ -418,58 +3366,90 @@ namespace rvec
             iterator& operator+=(difference_type n)
             {
                 index += n;
+                if (cur && n >= first - cur && n < last - cur)
+                {
+                    cur += n;
+                }
+                else
+                {
+                    seat();
+                }
                 return *this;
             }
 
             iterator& operator-=(difference_type n)
             {
-                index -= n;
-                return *this;
+                return *this += -n;
             }
 
             iterator operator+(difference_type n) const
             {
-                return iterator(parent, index + n);
+                iterator tmp = *this;
+                return tmp += n;
             }
 
             iterator operator-(difference_type n) const
             {
-                return iterator(parent, index - n);
+                iterator tmp = *this;
+                return tmp -= n;
+            }
+
+            friend iterator operator+(difference_type n, const iterator& it)
+            {
+                return it + n;
+            }
+
+            reference operator[](difference_type n) const
+            {
+                return *(*this + n);
             }
 
-            difference_type operator-(const iterator& other) const
+            // the container and the element index this iterator refers to
+            rope_vector* container() const noexcept
             {
-                return static_cast<difference_type>(index) - static_cast<difference_type>(other.index);
+                return parent;
             }
 
-            bool operator==(const iterator& other) const
+            size_type position() const noexcept
             {
-                return index == other.index;
+                return index;
             }
 
-            bool operator!=(const iterator& other) const
+            // comparisons are hidden friends so that the iterator and const_iterator
+            // overloads also serve mixed comparisons through the conversion
+            friend difference_type operator-(const iterator& a, const iterator& b)
             {
-                return index != other.index;
+                return static_cast<difference_type>(a.index) - static_cast<difference_type>(b.index);
             }
 
-            bool operator<(const iterator& other) const
+            friend bool operator==(const iterator& a, const iterator& b)
             {
-                return index < other.index;
+                return a.parent == b.parent && a.index == b.index;
             }
 
-            bool operator>(const iterator& other) const
+            friend bool operator!=(const iterator& a, const iterator& b)
             {
-                return index > other.index;
+                return !(a == b);
             }
 
-            bool operator<=(const iterator& other) const
+            friend bool operator<(const iterator& a, const iterator& b)
             {
-                return index <= other.index;
+                return a.index < b.index;
             }
 
-            bool operator>=(const iterator& other) const
+            friend bool operator>(const iterator& a, const iterator& b)
             {
-                return index >= other.index;
+                return a.index > b.index;
+            }
+
+            friend bool operator<=(const iterator& a, const iterator& b)
+            {
+                return a.index <= b.index;
+            }
+
+            friend bool operator>=(const iterator& a, const iterator& b)
+            {
+                return a.index >= b.index;
             }
         };
 
@@ -495,28 +3475,46 @@ namespace rvec
         private:
             const rope_vector* parent = nullptr;
             size_type index = 0;
+            T* cur = nullptr;
+            T* first = nullptr; // bounds of the run holding cur
+            T* last = nullptr;
+
+            void seat()
+            {
+                parent->seat_run(index, cur, first, last);
+            }
 
         public:
             const_iterator() = default;
 
             const_iterator(const rope_vector* rv, size_type i)
                 : parent(rv), index(i)
+            {
+                seat();
+            }
+
+            const_iterator(const iterator& it)
+                : parent(it.parent), index(it.index), cur(it.cur), first(it.first), last(it.last)
             {
             }
 
             reference operator*() const
             {
-                return (*parent)[index];
+                return *cur;
             }
 
             pointer operator->() const
             {
-                return &(*parent)[index];
+                return cur;
             }
 
             const_iterator& operator++()
             {
                 ++index;
+                if (++cur == last)
+                {
+                    seat();
+                }
                 return *this;
             }
 
@@ -530,6 +3528,14 @@ namespace rvec
             const_iterator& operator--()
             {
                 --index;
+                if (cur == first)
+                {
+                    seat();
+                }
+                else
+                {
+                    --cur;
+                }
                 return *this;
             }
 
@@ -543,63 +3549,87 @@ namespace rvec
             const_iterator& operator+=(difference_type n)
             {
                 index += n;
+                if (cur && n >= first - cur && n < last - cur)
+                {
+                    cur += n;
+                }
+                else
+                {
+                    seat();
+                }
                 return *this;
             }
 
             const_iterator& operator-=(difference_type n)
             {
-                index -= n;
-                return *this;
+                return *this += -n;
             }
 
             const_iterator operator+(difference_type n) const
             {
-                return const_iterator(parent, index + n);
+                const_iterator tmp = *this;
+                return tmp += n;
             }
 
             const_iterator operator-(difference_type n) const
             {
-                return const_iterator(parent, index - n);
+                const_iterator tmp = *this;
+                return tmp -= n;
             }
 
-            difference_type operator-(const const_iterator& other) const
+            friend const_iterator operator+(difference_type n, const const_iterator& it)
             {
-                return static_cast<difference_type>(index) - static_cast<difference_type>(other.index);
+                return it + n;
             }
 
             reference operator[](difference_type n) const
             {
-                return (*parent)[index + n];
+                return *(*this + n);
+            }
+
+            const rope_vector* container() const noexcept
+            {
+                return parent;
+            }
+
+            size_type position() const noexcept
+            {
+                return index;
+            }
+
+            friend difference_type operator-(const const_iterator& a, const const_iterator& b)
+            {
+                return static_cast<difference_type>(a.index) - static_cast<difference_type>(b.index);
             }
 
-            bool operator==(const const_iterator& other) const
+            friend bool operator==(const const_iterator& a, const const_iterator& b)
             {
-                return parent == other.parent && index == other.index;
+                return a.parent == b.parent && a.index == b.index;
             }
 
-            bool operator!=(const const_iterator& other) const
+            friend bool operator!=(const const_iterator& a, const const_iterator& b)
             {
-                return !(*this == other);
+                return !(a == b);
             }
 
-            bool operator<(const const_iterator& other) const
+            friend bool operator<(const const_iterator& a, const const_iterator& b)
             {
-                return index < other.index;
+                return a.index < b.index;
             }
 
-            bool operator>(const const_iterator& other) const
+            friend bool operator>(const const_iterator& a, const const_iterator& b)
             {
-                return index > other.index;
+                return a.index > b.index;
             }
 
-            bool operator<=(const const_iterator& other) const
+            friend bool operator<=(const const_iterator& a, const const_iterator& b)
             {
-                return index <= other.index;
+                return a.index <= b.index;
             }
 
-            bool operator>=(const const_iterator& other) const
+            friend bool operator>=(const const_iterator& a, const const_iterator& b)
             {
-                return index >= other.index;
+                return a.index >= b.index;
             }
         };
 
@@ -623,270 +3653,74 @@ namespace rvec
             return cend();
         }
 
-        class reverse_iterator
-        {
-        public:
-            using iterator_category = std::random_access_iterator_tag;
-            using value_type = T;
-            using difference_type = std::ptrdiff_t;
-            using pointer = T*;
-            using reference = T&;
-
-        private:
-            rope_vector* parent = nullptr;
-            size_type index = 0;
-
-        public:
-            reverse_iterator() = default;
-
-            reverse_iterator(rope_vector* rv, size_type i)
-                : parent(rv), index(i)
-            {
-            }
-
-            reference operator*() const
-            {
-                return (*parent)[index - 1];
-            }
-
-            pointer operator->() const
-            {
-                return &(*parent)[index - 1];
-            }
-
-            reverse_iterator& operator++()
-            {
-                --index;
-                return *this;
-            }
-
-            reverse_iterator operator++(int)
-            {
-                reverse_iterator tmp = *this;
-                --(*this);
-                return tmp;
-            }
-
-            reverse_iterator& operator--()
-            {
-                ++index;
-                return *this;
-            }
-
-            reverse_iterator operator--(int)
-            {
-                reverse_iterator tmp = *this;
-                ++(*this);
-                return tmp;
-            }
-
-            reverse_iterator& operator+=(difference_type n)
-            {
-                index -= n;
-                return *this;
-            }
-
-            reverse_iterator& operator-=(difference_type n)
-            {
-                index += n;
-                return *this;
-            }
-
-            reverse_iterator operator+(difference_type n) const
-            {
-                return reverse_iterator(parent, index - n);
-            }
-
-            reverse_iterator operator-(difference_type n) const
-            {
-                return reverse_iterator(parent, index + n);
-            }
-
-            difference_type operator-(const reverse_iterator& other) const
-            {
-                return static_cast<difference_type>(other.index) - static_cast<difference_type>(index);
-            }
-
-            bool operator==(const reverse_iterator& other) const
-            {
-                return index == other.index && parent == other.parent;
-            }
-
-            bool operator!=(const reverse_iterator& other) const
-            {
-                return !(*this == other);
-            }
-
-            bool operator<(const reverse_iterator& other) const
-            {
-                return index > other.index;
-            }
-
-            bool operator>(const reverse_iterator& other) const
-            {
-                return index < other.index;
-            }
-
-            bool operator<=(const reverse_iterator& other) const
-            {
-                return index >= other.index;
-            }
-
-            bool operator>=(const reverse_iterator& other) const
-            {
-                return index <= other.index;
-            }
-        };
+        // the forward iterators already step by pointer, so reversing them keeps that speed
+        using reverse_iterator = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
 
         reverse_iterator rbegin()
         {
-            return reverse_iterator(this, total_size);
+            return reverse_iterator(end());
         }
 
         reverse_iterator rend()
         {
-            return reverse_iterator(this, 0);
+            return reverse_iterator(begin());
         }
 
-        class const_reverse_iterator
-        {
-        public:
-            using iterator_category = std::random_access_iterator_tag;
-            using value_type = T;
-            using difference_type = std::ptrdiff_t;
-            using pointer = const T*;
-            using reference = const T&;
-
-        private:
-            const rope_vector* parent = nullptr;
-            size_type index = 0;
-
-        public:
-            const_reverse_iterator() = default;
-
-            const_reverse_iterator(const rope_vector* rv, size_type i)
-                : parent(rv), index(i)
-            {
-            }
-
-            reference operator*() const
-            {
-                return (*parent)[index - 1];
-            }
-
-            pointer operator->() const
-            {
-                return &(*parent)[index - 1];
-            }
-
-            const_reverse_iterator& operator++()
-            {
-                --index;
-                return *this;
-            }
-
-            const_reverse_iterator operator++(int)
-            {
-                const_reverse_iterator tmp = *this;
-                --(*this);
-                return tmp;
-            }
-
-            const_reverse_iterator& operator--()
-            {
-                ++index;
-                return *this;
-            }
-
-            const_reverse_iterator operator--(int)
-            {
-                const_reverse_iterator tmp = *this;
-                ++(*this);
-                return tmp;
-            }
-
-            const_reverse_iterator& operator+=(difference_type n)
-            {
-                index -= n;
-                return *this;
-            }
-
-            const_reverse_iterator& operator-=(difference_type n)
-            {
-                index += n;
-                return *this;
-            }
-
-            const_reverse_iterator operator+(difference_type n) const
-            {
-                return const_reverse_iterator(parent, index - n);
-            }
-
-            const_reverse_iterator operator-(difference_type n) const
-            {
-                return const_reverse_iterator(parent, index + n);
-            }
-
-            difference_type operator-(const const_reverse_iterator& other) const
-            {
-                return static_cast<difference_type>(other.index) - static_cast<difference_type>(index);
-            }
-
-            bool operator==(const const_reverse_iterator& other) const
-            {
-                return index == other.index && parent == other.parent;
-            }
-
-            bool operator!=(const const_reverse_iterator& other) const
-            {
-                return !(*this == other);
-            }
-
-            bool operator<(const const_reverse_iterator& other) const
-            {
-                return index > other.index;
-            }
-
-            bool operator>(const const_reverse_iterator& other) const
-            {
-                return index < other.index;
-            }
-
-            bool operator<=(const const_reverse_iterator& other) const
-            {
-                return index >= other.index;
-            }
-
-            bool operator>=(const const_reverse_iterator& other) const
-            {
-                return index <= other.index;
-            }
-        };
-
         const_reverse_iterator rbegin() const
         {
-            return const_reverse_iterator(this, total_size);
+            return const_reverse_iterator(end());
         }
 
         const_reverse_iterator rend() const
         {
-            return const_reverse_iterator(this, 0);
+            return const_reverse_iterator(begin());
         }
 
         const_reverse_iterator crbegin() const
         {
-            return const_reverse_iterator(this, total_size);
+            return const_reverse_iterator(end());
         }
 
         const_reverse_iterator crend() const
         {
-            return const_reverse_iterator(this, 0);
+            return const_reverse_iterator(begin());
         }
     };
 
-    template <typename T, std::size_t ChunkSize>
-    void swap(rope_vector<T, ChunkSize>& a, rope_vector<T, ChunkSize>& b) noexcept
+    template <typename T, std::size_t ChunkSize, typename Allocator>
+    void swap(rope_vector<T, ChunkSize, Allocator>& a, rope_vector<T, ChunkSize, Allocator>& b) noexcept
     {
         a.swap(b);
     }
+
+    // appends whatever fill(T* data, size_t room) writes, a chunk at a time: each call gets
+    // the span of rv.append_span() and returns how many elements it wrote there, which are
+    // committed. the loop ends once fill returns 0 or max_n elements have been appended, and
+    // returns how many were.
+    template <typename T, std::size_t ChunkSize, typename Allocator, typename Fill>
+    std::size_t back_insert_chunks(rope_vector<T, ChunkSize, Allocator>& rv, Fill fill, std::size_t max_n = static_cast<std::size_t>(-1))
+    {
+        std::size_t total = 0;
+        while (total < max_n)
+        {
+            auto span = rv.append_span(max_n - total);
+            std::size_t written = fill(span.data(), span.size());
+            assert(written <= span.size() && "rvec::back_insert_chunks() fill overran its span");
+            rv.commit(written);
+            total += written;
+            if (written == 0)
+            {
+                break;
+            }
+        }
+        return total;
+    }
+
+    namespace pmr
+    {
+        // rope_vector whose chunks and chunk tree come from a std::pmr::memory_resource
+        template <typename T, std::size_t ChunkSize = 256>
+        using rope_vector = rvec::rope_vector<T, ChunkSize, std::pmr::polymorphic_allocator<T>>;
+    } // namespace pmr
 } // namespace rvec
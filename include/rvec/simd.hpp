@@ -0,0 +1,735 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#include "rope_vector.hpp"
+
+// kernels are written once with GCC/Clang vector extensions and instantiated per vector width.
+// on x86 each width is compiled under its own target attribute and picked at runtime from
+// CPUID, so one binary runs SSE2, AVX2 or AVX-512 code. other GCC/Clang targets use their
+// baseline vector width; other compilers get the scalar loops.
+#if defined(__GNUC__) || defined(__clang__)
+#define RVEC_SIMD_VECTOR_EXT 1
+#define RVEC_SIMD_INLINE inline __attribute__((always_inline))
+#if defined(__x86_64__) || defined(__i386__)
+#define RVEC_SIMD_X86 1
+#endif
+#else
+#define RVEC_SIMD_INLINE inline
+#endif
+
+namespace rvec
+{
+    namespace simd
+    {
+        enum class isa
+        {
+            scalar,
+            sse2,
+            avx2,
+            avx512
+        };
+
+        inline isa detect_isa()
+        {
+#if defined(RVEC_SIMD_X86)
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512f"))
+            {
+                return isa::avx512;
+            }
+            if (__builtin_cpu_supports("avx2"))
+            {
+                return isa::avx2;
+            }
+            if (__builtin_cpu_supports("sse2"))
+            {
+                return isa::sse2;
+            }
+#elif defined(RVEC_SIMD_VECTOR_EXT)
+            return isa::sse2; // the baseline 16-byte vectors of the target
+#endif
+            return isa::scalar;
+        }
+
+        // the instruction set the kernels run with, detected once per process
+        inline isa active_isa()
+        {
+            static const isa level = detect_isa();
+            return level;
+        }
+
+        namespace detail
+        {
+            template <typename T>
+            struct is_element_type : std::integral_constant<bool, std::is_arithmetic<T>::value && !std::is_same<T, bool>::value>
+            {
+            };
+
+            // element types with vector lanes; long double has none worth having and always
+            // runs the scalar loop
+            template <typename T>
+            struct is_kernel_type : std::integral_constant<bool, is_element_type<T>::value && !std::is_same<T, long double>::value>
+            {
+            };
+
+            template <typename... Ptrs>
+            struct has_lanes : std::true_type
+            {
+            };
+
+            template <typename P, typename... Ptrs>
+            struct has_lanes<P, Ptrs...> : std::integral_constant<bool, is_kernel_type<typename std::remove_cv<typename std::remove_pointer<P>::type>::type>::value && has_lanes<Ptrs...>::value>
+            {
+            };
+
+#if defined(RVEC_SIMD_VECTOR_EXT)
+            template <typename T, std::size_t Width>
+            struct lanes
+            {
+                typedef T type __attribute__((vector_size(Width)));
+            };
+#endif
+
+            // every op has run<Width>(n, pointers...): Width is the vector size in bytes, or 0
+            // for the scalar loop. it folds one run into the op's state and returns false to
+            // stop the walk early.
+
+            template <typename T>
+            struct sum_op
+            {
+                T total = T();
+
+                template <std::size_t Width>
+                RVEC_SIMD_INLINE bool run(std::size_t n, const T* p)
+                {
+                    std::size_t i = 0;
+                    T s = T();
+#if defined(RVEC_SIMD_VECTOR_EXT)
+                    if constexpr (Width != 0)
+                    {
+                        using V = typename lanes<T, Width>::type;
+                        constexpr std::size_t L = Width / sizeof(T);
+                        V a0 = {}, a1 = {}, a2 = {}, a3 = {};
+                        for (std::size_t body = n - n % (4 * L); i < body; i += 4 * L)
+                        {
+                            V x0, x1, x2, x3;
+                            std::memcpy(&x0, p + i, Width);
+                            std::memcpy(&x1, p + i + L, Width);
+                            std::memcpy(&x2, p + i + 2 * L, Width);
+                            std::memcpy(&x3, p + i + 3 * L, Width);
+                            a0 += x0;
+                            a1 += x1;
+                            a2 += x2;
+                            a3 += x3;
+                        }
+                        a0 = (a0 + a1) + (a2 + a3);
+                        for (std::size_t k = 0; k < L; ++k)
+                        {
+                            s += a0[k];
+                        }
+                    }
+#endif
+                    for (; i < n; ++i)
+                    {
+                        s += p[i];
+                    }
+                    total += s;
+                    return true;
+                }
+            };
+
+            template <typename T>
+            struct dot_op
+            {
+                T total = T();
+
+                template <std::size_t Width>
+                RVEC_SIMD_INLINE bool run(std::size_t n, const T* p, const T* q)
+                {
+                    std::size_t i = 0;
+                    T s = T();
+#if defined(RVEC_SIMD_VECTOR_EXT)
+                    if constexpr (Width != 0)
+                    {
+                        using V = typename lanes<T, Width>::type;
+                        constexpr std::size_t L = Width / sizeof(T);
+                        V a0 = {}, a1 = {};
+                        for (std::size_t body = n - n % (2 * L); i < body; i += 2 * L)
+                        {
+                            V x0, x1, y0, y1;
+                            std::memcpy(&x0, p + i, Width);
+                            std::memcpy(&x1, p + i + L, Width);
+                            std::memcpy(&y0, q + i, Width);
+                            std::memcpy(&y1, q + i + L, Width);
+                            a0 += x0 * y0;
+                            a1 += x1 * y1;
+                        }
+                        a0 += a1;
+                        for (std::size_t k = 0; k < L; ++k)
+                        {
+                            s += a0[k];
+                        }
+                    }
+#endif
+                    for (; i < n; ++i)
+                    {
+                        s += p[i] * q[i];
+                    }
+                    total += s;
+                    return true;
+                }
+            };
+
+            template <typename T>
+            struct minmax_op
+            {
+                T lo = T();
+                T hi = T();
+                bool seeded = false;
+
+                template <std::size_t Width>
+                RVEC_SIMD_INLINE bool run(std::size_t n, const T* p)
+                {
+                    std::size_t i = 0;
+                    if (!seeded)
+                    {
+                        lo = hi = p[0];
+                        seeded = true;
+                    }
+                    T l = lo;
+                    T h = hi;
+#if defined(RVEC_SIMD_VECTOR_EXT)
+                    if constexpr (Width != 0)
+                    {
+                        using V = typename lanes<T, Width>::type;
+                        constexpr std::size_t L = Width / sizeof(T);
+                        if (n >= L)
+                        {
+                            V vl, vh;
+                            std::memcpy(&vl, p, Width);
+                            vh = vl;
+                            for (i = L; i < n - n % L; i += L)
+                            {
+                                V x;
+                                std::memcpy(&x, p + i, Width);
+                                vl = x < vl ? x : vl;
+                                vh = x > vh ? x : vh;
+                            }
+                            for (std::size_t k = 0; k < L; ++k)
+                            {
+                                l = vl[k] < l ? vl[k] : l;
+                                h = vh[k] > h ? vh[k] : h;
+                            }
+                        }
+                    }
+#endif
+                    for (; i < n; ++i)
+                    {
+                        l = p[i] < l ? p[i] : l;
+                        h = p[i] > h ? p[i] : h;
+                    }
+                    lo = l;
+                    hi = h;
+                    return true;
+                }
+            };
+
+            template <typename T>
+            struct count_op
+            {
+                T value;
+                std::size_t hits = 0;
+
+                template <std::size_t Width>
+                RVEC_SIMD_INLINE bool run(std::size_t n, const T* p)
+                {
+                    std::size_t i = 0;
+#if defined(RVEC_SIMD_VECTOR_EXT)
+                    if constexpr (Width != 0)
+                    {
+                        using V = typename lanes<T, Width>::type;
+                        constexpr std::size_t L = Width / sizeof(T);
+                        V needle = V{} + value;
+                        // comparisons yield -1 per matching lane. the lane counters are as
+                        // narrow as T, so they are flushed into hits before they can overflow:
+                        // every 127 vectors for 1-byte lanes, every 32767 for 2-byte ones.
+                        using M = decltype(needle == needle);
+                        using lane = typename std::remove_reference<decltype(std::declval<M&>()[0])>::type;
+                        constexpr std::size_t step = L * static_cast<std::size_t>(std::numeric_limits<lane>::max());
+                        for (std::size_t body = n - n % L; i < body;)
+                        {
+                            M tally = {};
+                            for (std::size_t stop = body - i > step ? i + step : body; i < stop; i += L)
+                            {
+                                V x;
+                                std::memcpy(&x, p + i, Width);
+                                tally -= (x == needle);
+                            }
+                            for (std::size_t k = 0; k < L; ++k)
+                            {
+                                hits += static_cast<std::size_t>(tally[k]);
+                            }
+                        }
+                    }
+#endif
+                    for (; i < n; ++i)
+                    {
+                        hits += p[i] == value ? 1 : 0;
+                    }
+                    return true;
+                }
+            };
+
+            template <typename T>
+            struct find_op
+            {
+                T value;
+                std::size_t index = 0; // elements passed so far, then the match position
+                bool found = false;
+
+                template <std::size_t Width>
+                RVEC_SIMD_INLINE bool run(std::size_t n, const T* p)
+                {
+                    std::size_t i = 0;
+#if defined(RVEC_SIMD_VECTOR_EXT)
+                    if constexpr (Width != 0)
+                    {
+                        using V = typename lanes<T, Width>::type;
+                        constexpr std::size_t L = Width / sizeof(T);
+                        V needle = V{} + value;
+                        for (std::size_t body = n - n % L; i < body; i += L)
+                        {
+                            V x;
+                            std::memcpy(&x, p + i, Width);
+                            auto mask = x == needle;
+                            std::uint64_t words[Width / 8];
+                            std::memcpy(words, &mask, Width);
+                            std::uint64_t any = 0;
+                            for (std::size_t w = 0; w < Width / 8; ++w)
+                            {
+                                any |= words[w];
+                            }
+                            if (any != 0)
+                            {
+                                break; // the scalar loop below pins down the lane
+                            }
+                        }
+                    }
+#endif
+                    for (; i < n; ++i)
+                    {
+                        if (p[i] == value)
+                        {
+                            index += i;
+                            found = true;
+                            return false;
+                        }
+                    }
+                    index += n;
+                    return true;
+                }
+            };
+
+            enum class elementwise
+            {
+                plus,
+                minus,
+                times,
+                less,
+                equal
+            };
+
+            // the operation is spelled out in each loop rather than passed as a functor:
+            // vector values must not cross a call outside the target-specific kernels
+            template <typename T, elementwise Kind>
+            struct map_op
+            {
+                template <std::size_t Width>
+                RVEC_SIMD_INLINE bool run(std::size_t n, T* o, const T* p, const T* q)
+                {
+                    std::size_t i = 0;
+#if defined(RVEC_SIMD_VECTOR_EXT)
+                    if constexpr (Width != 0)
+                    {
+                        using V = typename lanes<T, Width>::type;
+                        constexpr std::size_t L = Width / sizeof(T);
+                        for (std::size_t body = n - n % L; i < body; i += L)
+                        {
+                            V x, y, r;
+                            std::memcpy(&x, p + i, Width);
+                            std::memcpy(&y, q + i, Width);
+                            if constexpr (Kind == elementwise::plus)
+                            {
+                                r = x + y;
+                            }
+                            else if constexpr (Kind == elementwise::minus)
+                            {
+                                r = x - y;
+                            }
+                            else
+                            {
+                                r = x * y;
+                            }
+                            std::memcpy(o + i, &r, Width);
+                        }
+                    }
+#endif
+                    for (; i < n; ++i)
+                    {
+                        if constexpr (Kind == elementwise::plus)
+                        {
+                            o[i] = p[i] + q[i];
+                        }
+                        else if constexpr (Kind == elementwise::minus)
+                        {
+                            o[i] = p[i] - q[i];
+                        }
+                        else
+                        {
+                            o[i] = p[i] * q[i];
+                        }
+                    }
+                    return true;
+                }
+            };
+
+            template <typename T>
+            struct axpy_op
+            {
+                T alpha;
+
+                template <std::size_t Width>
+                RVEC_SIMD_INLINE bool run(std::size_t n, T* y, const T* x)
+                {
+                    std::size_t i = 0;
+#if defined(RVEC_SIMD_VECTOR_EXT)
+                    if constexpr (Width != 0)
+                    {
+                        using V = typename lanes<T, Width>::type;
+                        constexpr std::size_t L = Width / sizeof(T);
+                        V a = V{} + alpha;
+                        for (std::size_t body = n - n % L; i < body; i += L)
+                        {
+                            V u, v;
+                            std::memcpy(&u, x + i, Width);
+                            std::memcpy(&v, y + i, Width);
+                            v += a * u;
+                            std::memcpy(y + i, &v, Width);
+                        }
+                    }
+#endif
+                    for (; i < n; ++i)
+                    {
+                        y[i] += alpha * x[i];
+                    }
+                    return true;
+                }
+            };
+
+            // o[i] = 0 or 1 from comparing p[i] with q[i], in any mask element type M
+            template <typename T, typename M, elementwise Kind>
+            struct mask_op
+            {
+                template <std::size_t Width>
+                RVEC_SIMD_INLINE bool run(std::size_t n, M* o, const T* p, const T* q)
+                {
+                    std::size_t i = 0;
+#if defined(RVEC_SIMD_VECTOR_EXT)
+                    if constexpr (Width != 0)
+                    {
+                        using V = typename lanes<T, Width>::type;
+                        constexpr std::size_t L = Width / sizeof(T);
+                        using mask = decltype(V{} < V{}); // -1 in every true lane
+                        using lane = typename std::remove_reference<decltype(mask{}[0])>::type;
+                        for (std::size_t body = n - n % L; i < body; i += L)
+                        {
+                            V x, y;
+                            std::memcpy(&x, p + i, Width);
+                            std::memcpy(&y, q + i, Width);
+                            mask m;
+                            if constexpr (Kind == elementwise::less)
+                            {
+                                m = x < y;
+                            }
+                            else
+                            {
+                                m = x == y;
+                            }
+                            lane bits[L];
+                            std::memcpy(bits, &m, Width);
+                            for (std::size_t k = 0; k < L; ++k)
+                            {
+                                o[i + k] = static_cast<M>(bits[k] & 1);
+                            }
+                        }
+                    }
+#endif
+                    for (; i < n; ++i)
+                    {
+                        if constexpr (Kind == elementwise::less)
+                        {
+                            o[i] = static_cast<M>(p[i] < q[i]);
+                        }
+                        else
+                        {
+                            o[i] = static_cast<M>(p[i] == q[i]);
+                        }
+                    }
+                    return true;
+                }
+            };
+
+            // one entry point per instruction set. Fixed != 0 is the trip count of a full
+            // chunk, letting the compiler unroll the vector loop completely.
+            template <std::size_t Fixed, typename Op, typename... Ptrs>
+            bool run_scalar(Op& op, std::size_t n, Ptrs... p)
+            {
+                return op.template run<0>(Fixed != 0 ? Fixed : n, p...);
+            }
+
+#if defined(RVEC_SIMD_X86)
+            template <std::size_t Fixed, typename Op, typename... Ptrs>
+            __attribute__((target("sse2"))) bool run_sse2(Op& op, std::size_t n, Ptrs... p)
+            {
+                return op.template run<16>(Fixed != 0 ? Fixed : n, p...);
+            }
+
+            template <std::size_t Fixed, typename Op, typename... Ptrs>
+            __attribute__((target("avx2"))) bool run_avx2(Op& op, std::size_t n, Ptrs... p)
+            {
+                return op.template run<32>(Fixed != 0 ? Fixed : n, p...);
+            }
+
+            template <std::size_t Fixed, typename Op, typename... Ptrs>
+            __attribute__((target("avx512f"))) bool run_avx512(Op& op, std::size_t n, Ptrs... p)
+            {
+                return op.template run<64>(Fixed != 0 ? Fixed : n, p...);
+            }
+#elif defined(RVEC_SIMD_VECTOR_EXT)
+            template <std::size_t Fixed, typename Op, typename... Ptrs>
+            bool run_sse2(Op& op, std::size_t n, Ptrs... p)
+            {
+                return op.template run<16>(Fixed != 0 ? Fixed : n, p...);
+            }
+#endif
+
+            template <typename Op, typename... Ptrs>
+            using kernel = bool (*)(Op&, std::size_t, Ptrs...);
+
+            template <std::size_t Fixed, typename Op, typename... Ptrs>
+            kernel<Op, Ptrs...> pick()
+            {
+                if constexpr (has_lanes<Ptrs...>::value)
+                {
+                    switch (active_isa())
+                    {
+#if defined(RVEC_SIMD_X86)
+                    case isa::avx512:
+                        return &run_avx512<Fixed, Op, Ptrs...>;
+                    case isa::avx2:
+                        return &run_avx2<Fixed, Op, Ptrs...>;
+#endif
+#if defined(RVEC_SIMD_VECTOR_EXT)
+                    case isa::sse2:
+                        return &run_sse2<Fixed, Op, Ptrs...>;
+#endif
+                    default:
+                        break;
+                    }
+                }
+                return &run_scalar<Fixed, Op, Ptrs...>;
+            }
+
+            // feeds every run of rv through op, full chunks through the fixed-size kernel
+            template <typename Op, typename T, std::size_t ChunkSize, typename Allocator>
+            void reduce(Op& op, const rope_vector<T, ChunkSize, Allocator>& rv)
+            {
+                static_assert(is_element_type<T>::value, "rvec::simd kernels need an arithmetic element type");
+                kernel<Op, const T*> full = pick<ChunkSize, Op, const T*>();
+                kernel<Op, const T*> part = pick<0, Op, const T*>();
+                rv.for_each_chunk([&](const T* data, std::size_t n)
+                    {
+                        return n == ChunkSize ? full(op, n, data) : part(op, n, data);
+                    });
+            }
+
+            // walks several run_walkers in lockstep, each step as long as the shortest current
+            // run, so every piece handed to f is contiguous in all containers at once: the
+            // work splits at the union of their seams. f may return false to stop early.
+            template <typename F, typename... Walkers>
+            void lockstep(F& f, Walkers... w)
+            {
+                while (!(w.done() || ...))
+                {
+                    std::size_t n = std::min({ static_cast<std::size_t>(w.size())... });
+                    if constexpr (std::is_same<decltype(f(n, w.data()...)), bool>::value)
+                    {
+                        if (!f(n, w.data()...))
+                        {
+                            return;
+                        }
+                    }
+                    else
+                    {
+                        f(n, w.data()...);
+                    }
+                    (w.advance(n), ...);
+                }
+            }
+
+            template <typename First, typename... Rest>
+            bool same_sizes(const First& first, const Rest&... rest)
+            {
+                return ((rest.size() == first.size()) && ...);
+            }
+
+            // runs op over the zipped containers, piece by piece
+            template <typename Op, typename... Vectors>
+            void zip_apply(Op& op, Vectors&... v)
+            {
+                kernel<Op, decltype(v.runs().data())...> run = pick<0, Op, decltype(v.runs().data())...>();
+                auto f = [&](std::size_t n, auto... p)
+                {
+                    return run(op, n, p...);
+                };
+                lockstep(f, v.runs()...);
+            }
+        } // namespace detail
+
+        template <typename T, std::size_t ChunkSize, typename Allocator>
+        T sum(const rope_vector<T, ChunkSize, Allocator>& rv)
+        {
+            detail::sum_op<T> op;
+            detail::reduce(op, rv);
+            return op.total;
+        }
+
+        template <typename T, std::size_t ChunkSize, typename Allocator>
+        std::pair<T, T> minmax(const rope_vector<T, ChunkSize, Allocator>& rv)
+        {
+            assert(!rv.empty() && "rvec::simd::minmax() called on empty vector");
+            detail::minmax_op<T> op;
+            detail::reduce(op, rv);
+            return { op.lo, op.hi };
+        }
+
+        template <typename T, std::size_t ChunkSize, typename Allocator>
+        T min(const rope_vector<T, ChunkSize, Allocator>& rv)
+        {
+            return simd::minmax(rv).first;
+        }
+
+        template <typename T, std::size_t ChunkSize, typename Allocator>
+        T max(const rope_vector<T, ChunkSize, Allocator>& rv)
+        {
+            return simd::minmax(rv).second;
+        }
+
+        template <typename T, std::size_t ChunkSize, typename Allocator>
+        std::size_t count(const rope_vector<T, ChunkSize, Allocator>& rv, T value)
+        {
+            detail::count_op<T> op{ value };
+            detail::reduce(op, rv);
+            return op.hits;
+        }
+
+        // index of the first element equal to value, or rv.size()
+        template <typename T, std::size_t ChunkSize, typename Allocator>
+        std::size_t find(const rope_vector<T, ChunkSize, Allocator>& rv, T value)
+        {
+            detail::find_op<T> op{ value };
+            detail::reduce(op, rv);
+            return op.index;
+        }
+
+        // calls f(n, p...) with one pointer per container for every piece that is contiguous in
+        // all of them, splitting at the union of their chunk seams; pointers into non-const
+        // containers are writable. the containers must have equal sizes.
+        template <typename F, typename... Vectors>
+        void zip(F f, Vectors&... v)
+        {
+            static_assert(sizeof...(Vectors) != 0, "rvec::simd::zip() needs at least one container");
+            assert(detail::same_sizes(v...) && "rvec::simd::zip() needs equal sizes");
+            detail::lockstep(f, v.runs()...);
+        }
+
+        // sum of a[i] * b[i]
+        template <typename T, std::size_t ChunkSize, typename Allocator, std::size_t OtherChunkSize, typename OtherAllocator>
+        T dot(const rope_vector<T, ChunkSize, Allocator>& a, const rope_vector<T, OtherChunkSize, OtherAllocator>& b)
+        {
+            static_assert(detail::is_element_type<T>::value, "rvec::simd kernels need an arithmetic element type");
+            assert(a.size() == b.size() && "rvec::simd::dot() needs equal sizes");
+            detail::dot_op<T> op;
+            detail::zip_apply(op, a, b);
+            return op.total;
+        }
+
+        namespace detail
+        {
+            // out[i] = a[i] op b[i]; out is resized to match and may be a or b itself
+            template <typename Op, typename Out, typename A, typename B>
+            void map(Out& out, const A& a, const B& b)
+            {
+                assert(a.size() == b.size() && "rvec::simd element-wise kernels need equal sizes");
+                out.resize(a.size());
+                Op op;
+                zip_apply(op, out, a, b);
+            }
+        } // namespace detail
+
+        template <typename T, std::size_t ChunkSize, typename Allocator, std::size_t AChunk, typename AAlloc, std::size_t BChunk, typename BAlloc>
+        void add(rope_vector<T, ChunkSize, Allocator>& out, const rope_vector<T, AChunk, AAlloc>& a, const rope_vector<T, BChunk, BAlloc>& b)
+        {
+            static_assert(detail::is_element_type<T>::value, "rvec::simd kernels need an arithmetic element type");
+            detail::map<detail::map_op<T, detail::elementwise::plus>>(out, a, b);
+        }
+
+        template <typename T, std::size_t ChunkSize, typename Allocator, std::size_t AChunk, typename AAlloc, std::size_t BChunk, typename BAlloc>
+        void subtract(rope_vector<T, ChunkSize, Allocator>& out, const rope_vector<T, AChunk, AAlloc>& a, const rope_vector<T, BChunk, BAlloc>& b)
+        {
+            static_assert(detail::is_element_type<T>::value, "rvec::simd kernels need an arithmetic element type");
+            detail::map<detail::map_op<T, detail::elementwise::minus>>(out, a, b);
+        }
+
+        template <typename T, std::size_t ChunkSize, typename Allocator, std::size_t AChunk, typename AAlloc, std::size_t BChunk, typename BAlloc>
+        void multiply(rope_vector<T, ChunkSize, Allocator>& out, const rope_vector<T, AChunk, AAlloc>& a, const rope_vector<T, BChunk, BAlloc>& b)
+        {
+            static_assert(detail::is_element_type<T>::value, "rvec::simd kernels need an arithmetic element type");
+            detail::map<detail::map_op<T, detail::elementwise::times>>(out, a, b);
+        }
+
+        // y[i] += alpha * x[i]
+        template <typename T, std::size_t ChunkSize, typename Allocator, std::size_t XChunk, typename XAlloc>
+        void axpy(T alpha, const rope_vector<T, XChunk, XAlloc>& x, rope_vector<T, ChunkSize, Allocator>& y)
+        {
+            static_assert(detail::is_element_type<T>::value, "rvec::simd kernels need an arithmetic element type");
+            assert(x.size() == y.size() && "rvec::simd::axpy() needs equal sizes");
+            detail::axpy_op<T> op{ alpha };
+            detail::zip_apply(op, y, x);
+        }
+
+        // mask[i] = a[i] < b[i] as 0 or 1; mask is resized to match
+        template <typename M, std::size_t ChunkSize, typename Allocator, typename T, std::size_t AChunk, typename AAlloc, std::size_t BChunk, typename BAlloc>
+        void less(rope_vector<M, ChunkSize, Allocator>& mask, const rope_vector<T, AChunk, AAlloc>& a, const rope_vector<T, BChunk, BAlloc>& b)
+        {
+            static_assert(detail::is_element_type<T>::value, "rvec::simd kernels need an arithmetic element type");
+            detail::map<detail::mask_op<T, M, detail::elementwise::less>>(mask, a, b);
+        }
+
+        // mask[i] = a[i] == b[i] as 0 or 1; mask is resized to match
+        template <typename M, std::size_t ChunkSize, typename Allocator, typename T, std::size_t AChunk, typename AAlloc, std::size_t BChunk, typename BAlloc>
+        void equal(rope_vector<M, ChunkSize, Allocator>& mask, const rope_vector<T, AChunk, AAlloc>& a, const rope_vector<T, BChunk, BAlloc>& b)
+        {
+            static_assert(detail::is_element_type<T>::value, "rvec::simd kernels need an arithmetic element type");
+            detail::map<detail::mask_op<T, M, detail::elementwise::equal>>(mask, a, b);
+        }
+    } // namespace simd
+} // namespace rvec
@@ -0,0 +1,534 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "parallel.hpp"
+
+namespace rvec
+{
+    namespace par
+    {
+        namespace detail
+        {
+            // merge path: how many of the first k outputs of a stable merge of a[0, m) and
+            // b[0, n) come from a. ties go to a, matching std::merge.
+            template <typename ItA, typename ItB, typename Compare>
+            std::size_t co_rank(std::size_t k, ItA a, std::size_t m, ItB b, std::size_t n, Compare& comp)
+            {
+                std::size_t lo = k > n ? k - n : 0;
+                std::size_t hi = k < m ? k : m;
+                while (lo < hi)
+                {
+                    std::size_t i = lo + (hi - lo) / 2;
+                    if (!comp(b[k - i - 1], a[i]))
+                    {
+                        lo = i + 1; // a[i] is among the first k
+                    }
+                    else
+                    {
+                        hi = i;
+                    }
+                }
+                return lo;
+            }
+
+            // one slice [from, to) of the output of merging src[lo, mid) with src[mid, hi).
+            // take_from and take_to are how many elements of src[lo, mid) precede each end.
+            struct merge_piece
+            {
+                std::size_t lo, mid, hi;
+                std::size_t from, to;
+                std::size_t take_from = 0, take_to = 0;
+            };
+
+            // co-ranks both ends of the slice. every slice of a round is ranked before any is
+            // merged, since merging moves from elements another slice may still compare.
+            template <typename Src, typename Compare>
+            void rank_slice(Src src, merge_piece& p, Compare& comp)
+            {
+                Src a = src + static_cast<std::ptrdiff_t>(p.lo);
+                Src b = src + static_cast<std::ptrdiff_t>(p.mid);
+                p.take_from = co_rank(p.from - p.lo, a, p.mid - p.lo, b, p.hi - p.mid, comp);
+                p.take_to = co_rank(p.to - p.lo, a, p.mid - p.lo, b, p.hi - p.mid, comp);
+            }
+
+            // moves the ranked inputs of the slice into dst[from, to)
+            template <typename T, typename Compare>
+            void merge_slice(T* src, T* dst, const merge_piece& p, Compare& comp)
+            {
+                std::size_t j0 = p.from - p.lo - p.take_from;
+                std::size_t j1 = p.to - p.lo - p.take_to;
+                std::merge(std::make_move_iterator(src + p.lo + p.take_from), std::make_move_iterator(src + p.lo + p.take_to),
+                    std::make_move_iterator(src + p.mid + j0), std::make_move_iterator(src + p.mid + j1), dst + p.from, comp);
+            }
+
+            // the same into the chunks of rv: the merge loop runs over each run's raw slots
+            template <typename T, typename Vector, typename Compare>
+            void merge_into(T* src, Vector& rv, const merge_piece& p, Compare& comp)
+            {
+                T* a = src + p.lo + p.take_from;
+                T* a_end = src + p.lo + p.take_to;
+                T* b = src + p.mid + (p.from - p.lo - p.take_from);
+                T* b_end = src + p.mid + (p.to - p.lo - p.take_to);
+                auto body = [&](T* out, std::size_t k)
+                    {
+                        for (std::size_t i = 0; i < k; ++i)
+                        {
+                            if (b != b_end && (a == a_end || comp(*b, *a)))
+                            {
+                                out[i] = std::move(*b++);
+                            }
+                            else
+                            {
+                                out[i] = std::move(*a++);
+                            }
+                        }
+                    };
+                walk(rv, p.from, p.to, body);
+            }
+
+            // cuts the output of each pair of neighbouring sorted segments into slices about
+            // grain long. with a container as the destination, slice ends are moved to chunk
+            // seams so that no two slices write the same chunk.
+            template <typename Vector>
+            std::vector<merge_piece> plan_merges(const std::vector<std::size_t>& bounds, std::size_t grain, const Vector* seams)
+            {
+                std::vector<merge_piece> pieces;
+                for (std::size_t s = 0; s + 1 < bounds.size(); s += 2)
+                {
+                    std::size_t lo = bounds[s];
+                    std::size_t mid = bounds[s + 1];
+                    std::size_t hi = s + 2 < bounds.size() ? bounds[s + 2] : mid;
+                    std::size_t from = lo;
+                    while (from < hi)
+                    {
+                        std::size_t to = hi - from > grain ? from + grain : hi;
+                        if (to < hi && seams != nullptr)
+                        {
+                            to = seams->chunk_end(to);
+                            to = to < hi ? to : hi;
+                        }
+                        pieces.push_back(merge_piece{ lo, mid, hi, from, to });
+                        from = to;
+                    }
+                }
+                return pieces;
+            }
+
+            // unsigned image of an arithmetic key that orders the same way
+            template <typename T>
+            struct radix_key
+            {
+                using type = typename std::conditional<sizeof(T) == 1, std::uint8_t,
+                    typename std::conditional<sizeof(T) == 2, std::uint16_t,
+                        typename std::conditional<sizeof(T) == 4, std::uint32_t, std::uint64_t>::type>::type>::type;
+
+                static constexpr type sign = type(1) << (8 * sizeof(T) - 1);
+
+                static type get(T v)
+                {
+                    if constexpr (std::is_floating_point<T>::value)
+                    {
+                        type bits;
+                        std::memcpy(&bits, &v, sizeof(T));
+                        return (bits & sign) != 0 ? type(~bits) : type(bits | sign);
+                    }
+                    else if constexpr (std::is_signed<T>::value)
+                    {
+                        return static_cast<type>(v) ^ sign;
+                    }
+                    else
+                    {
+                        return static_cast<type>(v);
+                    }
+                }
+            };
+
+            // LSD radix sort of [first, last), one byte per pass. a single counting pass
+            // builds every byte's histogram, and passes whose byte is the same for every key
+            // are skipped, so narrow value ranges cost fewer passes.
+            template <typename T>
+            void radix_sort_span(T* first, T* last)
+            {
+                using key = radix_key<T>;
+                std::size_t n = static_cast<std::size_t>(last - first);
+                if (n < 2)
+                {
+                    return;
+                }
+
+                std::size_t counts[sizeof(T)][256] = {};
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    typename key::type k = key::get(first[i]);
+                    for (std::size_t d = 0; d < sizeof(T); ++d)
+                    {
+                        ++counts[d][(k >> (8 * d)) & 0xff];
+                    }
+                }
+
+                std::vector<T> scratch(n);
+                T* src = first;
+                T* dst = scratch.data();
+                typename key::type head = key::get(first[0]);
+                for (std::size_t d = 0; d < sizeof(T); ++d)
+                {
+                    std::size_t* offsets = counts[d];
+                    if (offsets[(head >> (8 * d)) & 0xff] == n)
+                    {
+                        continue;
+                    }
+
+                    std::size_t sum = 0;
+                    for (std::size_t b = 0; b < 256; ++b)
+                    {
+                        std::size_t c = offsets[b];
+                        offsets[b] = sum;
+                        sum += c;
+                    }
+                    for (std::size_t i = 0; i < n; ++i)
+                    {
+                        dst[offsets[(key::get(src[i]) >> (8 * d)) & 0xff]++] = src[i];
+                    }
+                    std::swap(src, dst);
+                }
+                if (src != first)
+                {
+                    std::copy(src, src + n, first);
+                }
+            }
+
+            // moves each chunk-aligned range of rv into a scratch buffer and sorts it there
+            // with sort_span, then merges neighbouring ranges pairwise, round by round,
+            // between two scratch buffers. every round is split into merge-path slices that
+            // run in parallel; the last round writes straight into the chunks.
+            template <typename T, std::size_t ChunkSize, typename Allocator, typename Compare, typename SortSpan>
+            void sort(rope_vector<T, ChunkSize, Allocator>& rv, Compare& comp, thread_pool& pool, SortSpan sort_span)
+            {
+                std::size_t n = rv.size();
+                if (n < 2)
+                {
+                    return;
+                }
+
+                rv.unshare();
+                std::vector<std::size_t> bounds = partition(rv, 0, n, pool);
+                std::vector<T> front(n);
+                std::vector<T> back; // second buffer, needed from three ranges on
+                T* buf = front.data();
+
+                pool.run(bounds.size() - 1, [&](std::size_t s)
+                    {
+                        T* out = buf + bounds[s];
+                        auto body = [&out](T* data, std::size_t k)
+                            {
+                                out = std::move(data, data + k, out);
+                            };
+                        walk(rv, bounds[s], bounds[s + 1], body);
+                        sort_span(buf + bounds[s], buf + bounds[s + 1]);
+                    });
+
+                if (bounds.size() == 2)
+                {
+                    for_each_range(rv, 0, n, pool, [&](std::size_t first, std::size_t last)
+                        {
+                            const T* in = buf + first;
+                            auto body = [&in](T* data, std::size_t k)
+                                {
+                                    std::move(in, in + k, data);
+                                    in += k;
+                                };
+                            walk(rv, first, last, body);
+                        });
+                    return;
+                }
+
+                std::size_t grain = std::max<std::size_t>(4 * ChunkSize, n / (4 * (pool.size() + 1)));
+                while (bounds.size() > 2)
+                {
+                    bool last_round = bounds.size() <= 3;
+                    std::vector<merge_piece> pieces = plan_merges(bounds, grain, last_round ? &rv : nullptr);
+                    pool.run(pieces.size(), [&](std::size_t i)
+                        {
+                            rank_slice(buf, pieces[i], comp);
+                        });
+
+                    if (last_round)
+                    {
+                        pool.run(pieces.size(), [&](std::size_t i)
+                            {
+                                merge_into(buf, rv, pieces[i], comp);
+                            });
+                        return;
+                    }
+
+                    if (back.empty())
+                    {
+                        back.resize(n);
+                    }
+                    T* other = buf == front.data() ? back.data() : front.data();
+                    pool.run(pieces.size(), [&](std::size_t i)
+                        {
+                            merge_slice(buf, other, pieces[i], comp);
+                        });
+                    buf = other;
+
+                    std::vector<std::size_t> merged;
+                    for (std::size_t s = 0; s < bounds.size(); s += 2)
+                    {
+                        merged.push_back(bounds[s]);
+                    }
+                    if (merged.back() != n)
+                    {
+                        merged.push_back(n);
+                    }
+                    bounds.swap(merged);
+                }
+            }
+
+            // builds out as the stable merge of a[0, m) and b[0, n). the output chunks are cut
+            // into chunk-aligned slices, the inputs are co-ranked at every slice boundary, and
+            // then each worker constructs its own chunks in place. with Move the elements are
+            // moved out of the inputs, which is why all ranks are taken before any merging.
+            template <bool Move, typename ItA, typename ItB, typename T, std::size_t ChunkSize, typename Allocator, typename Compare>
+            void merge_build(ItA a, std::size_t m, ItB b, std::size_t n, rope_vector<T, ChunkSize, Allocator>& out, Compare& comp, thread_pool& pool)
+            {
+                std::size_t total = m + n;
+                out.assign_built(total, [&](std::size_t chunks, auto& writer)
+                    {
+                        if (chunks == 0)
+                        {
+                            return;
+                        }
+
+                        std::size_t slices = std::min(chunks, 4 * (pool.size() + 1));
+                        auto first_chunk = [chunks, slices](std::size_t t)
+                            {
+                                return chunks * t / slices;
+                            };
+                        auto start = [&](std::size_t t)
+                            {
+                                return std::min(total, first_chunk(t) * ChunkSize);
+                            };
+
+                        std::vector<std::size_t> split(slices + 1);
+                        pool.run(slices + 1, [&](std::size_t t)
+                            {
+                                split[t] = co_rank(start(t), a, m, b, n, comp);
+                            });
+
+                        pool.run(slices, [&](std::size_t t)
+                            {
+                                std::size_t i = split[t];
+                                std::size_t i_end = split[t + 1];
+                                std::size_t j = start(t) - i;
+                                std::size_t j_end = start(t + 1) - i_end;
+                                ItA pa = a + static_cast<std::ptrdiff_t>(i);
+                                ItB pb = b + static_cast<std::ptrdiff_t>(j);
+                                for (std::size_t c = first_chunk(t); c < first_chunk(t + 1); ++c)
+                                {
+                                    auto w = writer(c);
+                                    while (w.remaining() != 0)
+                                    {
+                                        bool take_b = j != j_end && (i == i_end || comp(*pb, *pa));
+                                        if constexpr (Move)
+                                        {
+                                            w.emplace(take_b ? std::move(*pb) : std::move(*pa));
+                                        }
+                                        else
+                                        {
+                                            w.emplace(take_b ? *pb : *pa);
+                                        }
+                                        if (take_b)
+                                        {
+                                            ++pb;
+                                            ++j;
+                                        }
+                                        else
+                                        {
+                                            ++pa;
+                                            ++i;
+                                        }
+                                    }
+                                }
+                            });
+                    });
+            }
+        } // namespace detail
+    } // namespace par
+
+    // sorts rv with comp on the thread pool: chunk-aligned ranges are sorted on their own
+    // in contiguous scratch memory, then merged back into the chunks with a parallel merge
+    // path. needs default-constructible T for the scratch buffer.
+    template <typename T, std::size_t ChunkSize, typename Allocator, typename Compare>
+    void sort(rope_vector<T, ChunkSize, Allocator>& rv, Compare comp, par::thread_pool& pool = par::default_pool())
+    {
+        par::detail::sort(rv, comp, pool, [&comp](T* first, T* last)
+            {
+                std::sort(first, last, comp);
+            });
+    }
+
+    template <typename T, std::size_t ChunkSize, typename Allocator, typename Compare>
+    void stable_sort(rope_vector<T, ChunkSize, Allocator>& rv, Compare comp, par::thread_pool& pool = par::default_pool())
+    {
+        par::detail::sort(rv, comp, pool, [&comp](T* first, T* last)
+            {
+                std::stable_sort(first, last, comp);
+            });
+    }
+
+    // ascending LSD radix sort for integral and floating-point elements of up to 8 bytes;
+    // stable, with -0.0 ordered before 0.0 and NaNs by their bits: negative ones before
+    // -inf, positive ones after inf. the merge rounds compare the same keys, so the whole
+    // sort follows one order.
+    template <typename T, std::size_t ChunkSize, typename Allocator>
+    void radix_sort(rope_vector<T, ChunkSize, Allocator>& rv, par::thread_pool& pool = par::default_pool())
+    {
+        static_assert(std::is_arithmetic<T>::value && !std::is_same<T, bool>::value && sizeof(T) <= 8, "rvec::radix_sort() needs integral or floating-point elements of up to 8 bytes");
+        auto comp = [](const T& a, const T& b)
+            {
+                return par::detail::radix_key<T>::get(a) < par::detail::radix_key<T>::get(b);
+            };
+        par::detail::sort(rv, comp, pool, [](T* first, T* last)
+            {
+                par::detail::radix_sort_span(first, last);
+            });
+    }
+
+    // ascending order; arithmetic elements of up to 8 bytes take the radix path
+    template <typename T, std::size_t ChunkSize, typename Allocator>
+    void sort(rope_vector<T, ChunkSize, Allocator>& rv, par::thread_pool& pool = par::default_pool())
+    {
+        if constexpr (std::is_arithmetic<T>::value && !std::is_same<T, bool>::value && sizeof(T) <= 8)
+        {
+            rvec::radix_sort(rv, pool);
+        }
+        else
+        {
+            rvec::sort(rv, std::less<T>(), pool);
+        }
+    }
+
+    // ascending order; integral elements take the radix path. floating-point ones do not,
+    // since the radix order separates -0.0 and 0.0, which compare equal.
+    template <typename T, std::size_t ChunkSize, typename Allocator>
+    void stable_sort(rope_vector<T, ChunkSize, Allocator>& rv, par::thread_pool& pool = par::default_pool())
+    {
+        if constexpr (std::is_integral<T>::value && !std::is_same<T, bool>::value)
+        {
+            rvec::radix_sort(rv, pool);
+        }
+        else
+        {
+            rvec::stable_sort(rv, std::less<T>(), pool);
+        }
+    }
+
+    // out = the stable merge of the sorted containers a and b, built in parallel straight
+    // into fresh chunks; out must be a third container
+    template <typename T, std::size_t ChunkSize, typename Allocator, std::size_t AChunk, typename AAlloc, std::size_t BChunk, typename BAlloc, typename Compare = std::less<>>
+    void merge(const rope_vector<T, AChunk, AAlloc>& a, const rope_vector<T, BChunk, BAlloc>& b, rope_vector<T, ChunkSize, Allocator>& out, Compare comp = Compare(), par::thread_pool& pool = par::default_pool())
+    {
+        assert(static_cast<const void*>(&out) != &a && static_cast<const void*>(&out) != &b && "rvec::merge() cannot write into an input");
+        par::detail::merge_build<false>(a.begin(), a.size(), b.begin(), b.size(), out, comp, pool);
+    }
+
+    // merges the sorted ranges [0, mid) and [mid, size()) of rv. the chunks are split off rv,
+    // which keeps its editing mode, spare limit and undo history, and the result is built
+    // back into fresh chunks. inside an undo group this is recorded like split_off(0)
+    // followed by an insert of the merged elements. if comp or a move throws, the unmerged
+    // elements are put back, though some of them may have been moved from.
+    template <typename T, std::size_t ChunkSize, typename Allocator, typename Compare = std::less<>>
+    void inplace_merge(rope_vector<T, ChunkSize, Allocator>& rv, std::size_t mid, Compare comp = Compare(), par::thread_pool& pool = par::default_pool())
+    {
+        assert(mid <= rv.size());
+        std::size_t n = rv.size();
+        rope_vector<T, ChunkSize, Allocator> source = rv.split_off(0);
+        try
+        {
+            // chunks the history shares are copied here, so the recorded ones keep their values
+            source.unshare();
+            auto first = source.begin();
+            par::detail::merge_build<true>(first, mid, first + static_cast<std::ptrdiff_t>(mid), n - mid, rv, comp, pool);
+        }
+        catch (...)
+        {
+            rv.append(std::move(source));
+            throw;
+        }
+    }
+
+    // out = the stable merge of the sorted containers in [first, last), ties going to the
+    // earlier input. k inputs are merged as a balanced tree of pairwise merges, ceil(log2 k)
+    // parallel rounds; every round but the first moves out of the previous round's results.
+    // out must not be one of the inputs.
+    template <typename InputIt, typename T, std::size_t ChunkSize, typename Allocator, typename Compare = std::less<>>
+    void merge_all(InputIt first, InputIt last, rope_vector<T, ChunkSize, Allocator>& out, Compare comp = Compare(), par::thread_pool& pool = par::default_pool())
+    {
+        assert(std::none_of(first, last, [&out](const auto& in) { return static_cast<const void*>(&in) == &out; }) && "rvec::merge_all() cannot write into an input");
+        using vector_type = rope_vector<T, ChunkSize, Allocator>;
+        std::size_t k = static_cast<std::size_t>(std::distance(first, last));
+        if (k == 0)
+        {
+            out.clear();
+            return;
+        }
+        if (k == 1)
+        {
+            // read through const iterators, so a non-const input shared with a copy is not unshared
+            par::detail::merge_build<false>(first->cbegin(), first->size(), first->cend(), 0, out, comp, pool);
+            return;
+        }
+        if (k == 2)
+        {
+            const auto& a = *first;
+            const auto& b = *std::next(first);
+            par::detail::merge_build<false>(a.begin(), a.size(), b.begin(), b.size(), out, comp, pool);
+            return;
+        }
+
+        std::vector<vector_type> level;
+        level.reserve((k + 1) / 2);
+        for (InputIt it = first; it != last;)
+        {
+            const auto& a = *it++;
+            level.emplace_back(out.get_allocator());
+            if (it != last)
+            {
+                const auto& b = *it++;
+                par::detail::merge_build<false>(a.begin(), a.size(), b.begin(), b.size(), level.back(), comp, pool);
+            }
+            else
+            {
+                par::detail::merge_build<false>(a.begin(), a.size(), a.end(), 0, level.back(), comp, pool);
+            }
+        }
+
+        while (level.size() > 2)
+        {
+            std::vector<vector_type> next;
+            next.reserve((level.size() + 1) / 2);
+            for (std::size_t i = 0; i < level.size(); i += 2)
+            {
+                if (i + 1 == level.size())
+                {
+                    next.push_back(std::move(level[i]));
+                    break;
+                }
+                next.emplace_back(out.get_allocator());
+                par::detail::merge_build<true>(level[i].begin(), level[i].size(), level[i + 1].begin(), level[i + 1].size(), next.back(), comp, pool);
+            }
+            level.swap(next);
+        }
+        par::detail::merge_build<true>(level[0].begin(), level[0].size(), level[1].begin(), level[1].size(), out, comp, pool);
+    }
+} // namespace rvec
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+
+// a failed CHECK reports itself and the test carries on; main() returns report()
+namespace rvec_test
+{
+    inline int failures = 0;
+
+    inline int report()
+    {
+        if (failures != 0)
+        {
+            std::fprintf(stderr, "%d check(s) failed\n", failures);
+            return 1;
+        }
+        return 0;
+    }
+
+    // true when rv holds exactly the elements of the reference sequence, read both through
+    // operator[] and through the iterators
+    template <typename Vector, typename Reference>
+    bool same(const Vector& rv, const Reference& ref)
+    {
+        if (rv.size() != ref.size())
+        {
+            return false;
+        }
+        std::size_t i = 0;
+        for (const auto& x : rv)
+        {
+            if (!(x == ref[i]) || !(rv[i] == ref[i]))
+            {
+                return false;
+            }
+            ++i;
+        }
+        return i == ref.size();
+    }
+} // namespace rvec_test
+
+#define CHECK(cond) \
+    do \
+    { \
+        if (!(cond)) \
+        { \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            ++rvec_test::failures; \
+        } \
+    } while (0)
@@ -0,0 +1,79 @@
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <numeric>
+#include <vector>
+
+#include "rvec/algorithm.hpp"
+
+#include "check.hpp"
+
+using rvec_test::same;
+
+namespace
+{
+    // a container with a short first chunk and an editing gap, so the runs the algorithms
+    // see are uneven
+    rvec::rope_vector<int, 32> uneven(std::vector<int>& ref)
+    {
+        rvec::rope_vector<int, 32> rv;
+        for (int i = 0; i < 1000; ++i)
+        {
+            rv.push_back(i);
+            ref.push_back(i);
+        }
+        for (int i = 0; i < 5; ++i)
+        {
+            rv.erase_front();
+            ref.erase(ref.begin());
+        }
+        rv.set_editing_mode(true);
+        rv.insert(400, -7);
+        ref.insert(ref.begin() + 400, -7);
+        return rv;
+    }
+
+    void segmented_algorithms_match_std()
+    {
+        std::vector<int> ref;
+        rvec::rope_vector<int, 32> rv = uneven(ref);
+        const rvec::rope_vector<int, 32>& view = rv;
+
+        long long sum = 0;
+        rvec::for_each(view, [&sum](int x) { sum += x; });
+        CHECK(sum == std::accumulate(ref.begin(), ref.end(), 0LL));
+        CHECK(rvec::accumulate(view, 0LL) == sum);
+        CHECK(rvec::accumulate(view, 1LL, [](long long a, int x) { return a + 2 * x; }) == 1 + 2 * sum);
+        CHECK(rvec::count_if(view, [](int x) { return x % 3 == 0; }) == static_cast<std::size_t>(std::count_if(ref.begin(), ref.end(), [](int x) { return x % 3 == 0; })));
+
+        CHECK(rvec::find_index(view, -7) == 400);
+        CHECK(rvec::find_index(view, 123456) == rv.size());
+        CHECK(rvec::find(rv, 500) - rv.begin() == 496);
+        CHECK(rvec::find(view, 123456) == view.end());
+
+        std::vector<int> copied;
+        rvec::copy(view, std::back_inserter(copied));
+        CHECK(copied == ref);
+
+        std::vector<int> doubled;
+        rvec::transform(view, std::back_inserter(doubled), [](int x) { return 2 * x; });
+        CHECK(doubled.size() == ref.size() && doubled[400] == -14 && doubled[0] == 10);
+
+        rvec::transform(rv, [](int x) { return x + 1; });
+        rvec::for_each(rv, [](int& x) { x *= 3; });
+        for (int& x : ref)
+        {
+            x = (x + 1) * 3;
+        }
+        CHECK(same(rv, ref));
+
+        rvec::fill(rv, 4);
+        CHECK(rvec::count_if(view, [](int x) { return x == 4; }) == rv.size());
+    }
+} // namespace
+
+int main()
+{
+    segmented_algorithms_match_std();
+    return rvec_test::report();
+}
@@ -0,0 +1,85 @@
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include "rvec/chunk_pool.hpp"
+
+#include "check.hpp"
+
+namespace
+{
+    std::size_t served(const rvec::pool_stats& s)
+    {
+        return s.hits + s.depot_hits + s.misses;
+    }
+
+    void fill(rvec::pooled::rope_vector<int, 64>& rv, int n)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            rv.push_back(i);
+        }
+    }
+
+    // blocks freed by one container serve the next one without new misses
+    void freed_chunks_are_reused()
+    {
+        {
+            rvec::pooled::rope_vector<int, 64> warm;
+            fill(warm, 4096);
+        }
+        rvec::pool_stats before = rvec::chunk_pool_stats();
+        {
+            rvec::pooled::rope_vector<int, 64> rv;
+            fill(rv, 4096);
+            bool in_order = true;
+            for (std::size_t i = 0; i < rv.size(); ++i)
+            {
+                in_order = in_order && rv[i] == static_cast<int>(i);
+            }
+            CHECK(in_order);
+        }
+        rvec::pool_stats after = rvec::chunk_pool_stats();
+        CHECK(after.misses == before.misses);
+        CHECK(after.hits > before.hits);
+    }
+
+    // counters of threads that have exited stay in the totals, and readers may ask for the
+    // totals while other threads allocate
+    void stats_survive_their_threads()
+    {
+        rvec::pool_stats before = rvec::chunk_pool_stats();
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t)
+        {
+            threads.emplace_back([]
+                {
+                    for (int round = 0; round < 20; ++round)
+                    {
+                        rvec::pooled::rope_vector<int, 64> rv;
+                        fill(rv, 2000);
+                    }
+                });
+        }
+        std::size_t seen = 0;
+        for (int i = 0; i < 50; ++i)
+        {
+            seen = served(rvec::chunk_pool_stats());
+        }
+        for (std::thread& t : threads)
+        {
+            t.join();
+        }
+        rvec::pool_stats after = rvec::chunk_pool_stats();
+        CHECK(served(after) >= seen);
+        // 4 threads * 20 rounds * 32 chunks each at the least
+        CHECK(served(after) - served(before) >= 4 * 20 * 32);
+    }
+} // namespace
+
+int main()
+{
+    freed_chunks_are_reused();
+    stats_survive_their_threads();
+    return rvec_test::report();
+}
@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#include "rvec/parallel.hpp"
+
+#include "check.hpp"
+
+using rvec_test::same;
+
+namespace
+{
+    // ranges must split on seams that do not fall on multiples of the chunk size
+    rvec::rope_vector<long long, 64> uneven(std::vector<long long>& ref, int n)
+    {
+        rvec::rope_vector<long long, 64> rv;
+        for (int i = 0; i < n; ++i)
+        {
+            rv.push_back(i);
+            ref.push_back(i);
+        }
+        for (int i = 0; i < 10; ++i)
+        {
+            rv.erase_front();
+            ref.erase(ref.begin());
+        }
+        rv.insert(1000, -1);
+        ref.insert(ref.begin() + 1000, -1);
+        return rv;
+    }
+
+    void chunk_partitioned_algorithms_match_std()
+    {
+        rvec::par::thread_pool pool(4);
+        std::vector<long long> ref;
+        rvec::rope_vector<long long, 64> rv = uneven(ref, 50000);
+
+        CHECK(rvec::par::reduce(rv, pool) == std::accumulate(ref.begin(), ref.end(), 0LL));
+        CHECK(rvec::par::reduce(rv, 5LL, [](long long a, long long b) { return a + b; }, pool) == 5 + std::accumulate(ref.begin(), ref.end(), 0LL));
+        CHECK(rvec::par::count_if(rv, [](long long x) { return x % 7 == 0; }, pool) == static_cast<std::size_t>(std::count_if(ref.begin(), ref.end(), [](long long x) { return x % 7 == 0; })));
+
+        std::atomic<long long> visited{ 0 };
+        const rvec::rope_vector<long long, 64>& view = rv;
+        rvec::par::for_each(view, [&visited](long long x) { visited.fetch_add(x, std::memory_order_relaxed); }, pool);
+        CHECK(visited.load() == std::accumulate(ref.begin(), ref.end(), 0LL));
+
+        rvec::par::for_each(rv, [](long long& x) { x *= 2; }, pool);
+        rvec::par::transform(rv, [](long long x) { return x + 1; }, pool);
+        for (long long& x : ref)
+        {
+            x = 2 * x + 1;
+        }
+        CHECK(same(rv, ref));
+
+        rvec::par::inclusive_scan(rv, pool);
+        std::partial_sum(ref.begin(), ref.end(), ref.begin());
+        CHECK(same(rv, ref));
+
+        rvec::par::fill(rv, 3LL, pool);
+        CHECK(rvec::par::count_if(rv, [](long long x) { return x == 3; }, pool) == rv.size());
+    }
+
+    // out's seams differ from in's; out is resized and written along its own seams
+    void transform_into_another_container()
+    {
+        rvec::par::thread_pool pool(3);
+        std::vector<long long> ref;
+        rvec::rope_vector<long long, 64> in = uneven(ref, 20000);
+
+        rvec::rope_vector<int, 100> out;
+        for (int i = 0; i < 7; ++i)
+        {
+            out.push_back(0);
+        }
+        out.erase_front();
+        rvec::par::transform(in, out, [](long long x) { return static_cast<int>(x % 1000); }, pool);
+        bool agree = out.size() == ref.size();
+        for (std::size_t i = 0; agree && i < ref.size(); ++i)
+        {
+            agree = out[i] == static_cast<int>(ref[i] % 1000);
+        }
+        CHECK(agree);
+    }
+
+    // writing workers copy chunks the container shares, so a copy keeps its values
+    void parallel_writes_leave_copies_alone()
+    {
+        rvec::par::thread_pool pool(4);
+        std::vector<long long> ref;
+        rvec::rope_vector<long long, 64> rv = uneven(ref, 10000);
+        rvec::rope_vector<long long, 64> copy = rv;
+        rvec::par::fill(rv, 0LL, pool);
+        CHECK(same(copy, ref));
+        CHECK(rvec::par::reduce(rv, pool) == 0);
+    }
+
+    // the first exception a task throws reaches the caller once the pool is done
+    void exceptions_reach_the_caller()
+    {
+        rvec::par::thread_pool pool(2);
+        bool caught = false;
+        try
+        {
+            pool.run(64, [](std::size_t i)
+                {
+                    if (i == 17)
+                    {
+                        throw std::runtime_error("task 17");
+                    }
+                });
+        }
+        catch (const std::runtime_error&)
+        {
+            caught = true;
+        }
+        CHECK(caught);
+
+        std::atomic<int> ran{ 0 };
+        pool.run(100, [&ran](std::size_t) { ran.fetch_add(1); });
+        CHECK(ran.load() == 100);
+    }
+
+#if defined(__cpp_lib_execution)
+    // unqualified calls with a parallel policy on rope_vector iterators find rvec's
+    // overloads, which split sub-ranges on chunk seams; sequenced ones run the std algorithm
+    void execution_policy_overloads()
+    {
+        std::vector<long long> ref;
+        rvec::rope_vector<long long, 64> rv = uneven(ref, 30000);
+        auto first = rv.begin() + 7;
+        auto last = rv.end() - 13;
+        auto ref_first = ref.begin() + 7;
+        auto ref_last = ref.end() - 13;
+
+        for_each(std::execution::par, first, last, [](long long& x) { x += 5; });
+        std::for_each(ref_first, ref_last, [](long long& x) { x += 5; });
+        CHECK(same(rv, ref));
+
+        CHECK(reduce(std::execution::par_unseq, first, last, 0LL) == std::accumulate(ref_first, ref_last, 0LL));
+        CHECK(count_if(std::execution::par, first, last, [](long long x) { return x % 4 == 1; }) == std::count_if(ref_first, ref_last, [](long long x) { return x % 4 == 1; }));
+        CHECK(count_if(std::execution::seq, first, last, [](long long x) { return x % 4 == 1; }) == std::count_if(ref_first, ref_last, [](long long x) { return x % 4 == 1; }));
+
+        rvec::rope_vector<long long, 64> out;
+        out.resize(ref.size());
+        auto written = transform(std::execution::par, first, last, out.begin() + 7, [](long long x) { return -x; });
+        CHECK(written == out.end() - 13);
+        CHECK(out[7] == -ref[7] && out[out.size() - 14] == -ref[ref.size() - 14]);
+        CHECK(out[6] == 0 && out[out.size() - 13] == 0);
+
+        // seams of the written container unlike the input's, each task writing only its own
+        // chunks of it
+        rvec::rope_vector<long long, 100> shifted;
+        shifted.resize(ref.size());
+        transform(std::execution::par, first, last, shifted.begin() + 3, [](long long x) { return 2 * x; });
+        std::vector<long long> doubled(ref.size());
+        std::transform(ref_first, ref_last, doubled.begin() + 3, [](long long x) { return 2 * x; });
+        CHECK(same(shifted, doubled));
+
+        fill(std::execution::par, rv.begin(), rv.end(), 9LL);
+        CHECK(rvec::par::count_if(rv, [](long long x) { return x == 9; }) == rv.size());
+
+        // the iterators also drive the std parallel algorithms directly
+        std::sort(std::execution::par, out.begin(), out.end());
+        CHECK(std::is_sorted(out.begin(), out.end()));
+    }
+#endif
+} // namespace
+
+int main()
+{
+    chunk_partitioned_algorithms_match_std();
+    transform_into_another_container();
+    parallel_writes_leave_copies_alone();
+    exceptions_reach_the_caller();
+#if defined(__cpp_lib_execution)
+    execution_policy_overloads();
+#endif
+    return rvec_test::report();
+}
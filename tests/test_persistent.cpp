@@ -0,0 +1,172 @@
+#include <cstddef>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rvec/persistent_rope_vector.hpp"
+
+#include "check.hpp"
+
+using rvec_test::same;
+
+namespace
+{
+    // every edit returns a new version and leaves the old one intact; all versions kept
+    // along the way still match the model they were taken from
+    void versions_are_independent()
+    {
+        using strings = rvec::persistent_rope_vector<std::string, 8>;
+        std::vector<strings> versions{ strings{ "a", "b", "c" } };
+        std::vector<std::vector<std::string>> refs{ { "a", "b", "c" } };
+        std::mt19937 rng(19);
+        for (int step = 0; step < 3000; ++step)
+        {
+            std::size_t from = rng() % versions.size();
+            strings next = versions[from];
+            std::vector<std::string> ref = refs[from];
+            std::string value = std::to_string(step);
+            unsigned op = rng() % 4;
+            if (op == 0 || ref.empty())
+            {
+                std::size_t pos = rng() % (ref.size() + 1);
+                next = next.insert(pos, value);
+                ref.insert(ref.begin() + static_cast<std::ptrdiff_t>(pos), value);
+            }
+            else if (op == 1)
+            {
+                std::size_t pos = rng() % ref.size();
+                next = next.erase(pos);
+                ref.erase(ref.begin() + static_cast<std::ptrdiff_t>(pos));
+            }
+            else if (op == 2)
+            {
+                std::size_t pos = rng() % ref.size();
+                next = next.set(pos, value);
+                ref[pos] = value;
+            }
+            else
+            {
+                next = next.push_back(value);
+                ref.push_back(value);
+            }
+            CHECK(same(next, ref));
+            CHECK(same(versions[from], refs[from]));
+            versions.push_back(next);
+            refs.push_back(ref);
+        }
+
+        for (std::size_t v = 0; v < versions.size(); ++v)
+        {
+            CHECK(same(versions[v], refs[v]));
+        }
+        CHECK(versions[0] == strings({ "a", "b", "c" }));
+        CHECK(versions[0] != versions[0].set(1, "x"));
+    }
+
+    struct tracked
+    {
+        static int live;
+        int value = 0;
+
+        explicit tracked(int v)
+            : value(v)
+        {
+            ++live;
+        }
+
+        tracked(const tracked& other)
+            : value(other.value)
+        {
+            ++live;
+        }
+
+        ~tracked()
+        {
+            --live;
+        }
+
+        bool operator==(const tracked& other) const
+        {
+            return value == other.value;
+        }
+    };
+
+    int tracked::live = 0;
+
+    // an edit copies only the chunk it touches, and the last version to go frees the rest
+    void edits_copy_one_chunk()
+    {
+        {
+            rvec::persistent_rope_vector<tracked, 32> base;
+            for (int i = 0; i < 1000; ++i)
+            {
+                base = base.push_back(tracked(i));
+            }
+            CHECK(tracked::live == 1000);
+
+            auto edited = base.set(500, tracked(-1));
+            CHECK(tracked::live <= 1000 + 32);
+            CHECK(base[500].value == 500);
+            CHECK(edited[500].value == -1);
+
+            base = rvec::persistent_rope_vector<tracked, 32>();
+            CHECK(tracked::live == 1000);
+        }
+        CHECK(tracked::live == 0);
+    }
+
+    // any version can be read from several threads while new versions are built from it
+    void versions_read_across_threads()
+    {
+        rvec::persistent_rope_vector<int, 64> base;
+        for (int i = 0; i < 20000; ++i)
+        {
+            base = base.push_back(i);
+        }
+
+        std::vector<long long> sums(4);
+        std::vector<std::thread> threads;
+        for (std::size_t t = 0; t < sums.size(); ++t)
+        {
+            threads.emplace_back([&base, &sums, t] {
+                rvec::persistent_rope_vector<int, 64> mine = base;
+                for (int i = 0; i < 100; ++i)
+                {
+                    mine = mine.set(static_cast<std::size_t>(i) * 100, -1);
+                }
+                for (int x : base)
+                {
+                    sums[t] += x;
+                }
+                for (int x : mine)
+                {
+                    sums[t] -= x < 0 ? 0 : x;
+                }
+            });
+        }
+        for (std::thread& t : threads)
+        {
+            t.join();
+        }
+
+        long long overwritten = 0;
+        for (int i = 0; i < 100; ++i)
+        {
+            overwritten += i * 100;
+        }
+        for (long long s : sums)
+        {
+            CHECK(s == overwritten);
+        }
+        CHECK(base[100] == 100);
+    }
+} // namespace
+
+int main()
+{
+    versions_are_independent();
+    edits_copy_one_chunk();
+    versions_read_across_threads();
+    return rvec_test::report();
+}
@@ -0,0 +1,1843 @@
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "rvec/rope_vector.hpp"
+
+#include "check.hpp"
+
+using rvec_test::same;
+
+namespace
+{
+    // random inserts and erases against a std::vector model; small chunks force splits,
+    // merges and a tree several levels deep
+    void counted_tree_matches_model()
+    {
+        rvec::rope_vector<int, 16> rv;
+        std::vector<int> ref;
+        std::mt19937 rng(1);
+        for (int step = 0; step < 20000; ++step)
+        {
+            unsigned op = rng() % 4;
+            if (op != 0 || ref.empty())
+            {
+                std::size_t pos = rng() % (ref.size() + 1);
+                rv.insert(pos, step);
+                ref.insert(ref.begin() + static_cast<std::ptrdiff_t>(pos), step);
+            }
+            else
+            {
+                std::size_t pos = rng() % ref.size();
+                rv.erase(pos);
+                ref.erase(ref.begin() + static_cast<std::ptrdiff_t>(pos));
+            }
+            if (step % 1000 == 0)
+            {
+                CHECK(same(rv, ref));
+            }
+        }
+        CHECK(same(rv, ref));
+
+        while (!ref.empty())
+        {
+            std::size_t pos = rng() % ref.size();
+            rv.erase(pos);
+            ref.erase(ref.begin() + static_cast<std::ptrdiff_t>(pos));
+        }
+        CHECK(rv.empty());
+        CHECK(rv.begin() == rv.end());
+    }
+
+    // a mid insert into a large container keeps every other element in place
+    void middle_insert_keeps_neighbours()
+    {
+        rvec::rope_vector<int, 64> rv;
+        for (int i = 0; i < 100000; ++i)
+        {
+            rv.push_back(i);
+        }
+        rv.insert(50000, -1);
+        CHECK(rv.size() == 100001);
+        CHECK(rv[49999] == 49999);
+        CHECK(rv[50000] == -1);
+        CHECK(rv[50001] == 50000);
+        CHECK(rv.front() == 0 && rv.back() == 99999);
+
+        rv.erase(50000);
+        bool in_order = true;
+        for (std::size_t i = 0; i < rv.size(); ++i)
+        {
+            in_order = in_order && rv[i] == static_cast<int>(i);
+        }
+        CHECK(in_order);
+    }
+
+    // in editing mode a run of edits at one spot keeps the gap there; the contents read the
+    // same through indices, iterators and chunk runs, and leaving the mode packs the chunks
+    void editing_gap_follows_the_cursor()
+    {
+        rvec::rope_vector<std::string, 32> rv;
+        std::vector<std::string> ref;
+        for (int i = 0; i < 200; ++i)
+        {
+            rv.push_back(std::to_string(i));
+            ref.push_back(std::to_string(i));
+        }
+
+        rv.set_editing_mode(true);
+        CHECK(rv.editing_mode());
+        std::size_t cursor = 70;
+        for (int i = 0; i < 300; ++i)
+        {
+            if (i % 3 == 2)
+            {
+                rv.erase(cursor - 1);
+                ref.erase(ref.begin() + static_cast<std::ptrdiff_t>(cursor - 1));
+                --cursor;
+            }
+            else
+            {
+                rv.insert(cursor, "x" + std::to_string(i));
+                ref.insert(ref.begin() + static_cast<std::ptrdiff_t>(cursor), "x" + std::to_string(i));
+                ++cursor;
+            }
+        }
+        CHECK(same(rv, ref));
+
+        // the chunk holding the cursor is split around its gap into two runs
+        std::vector<std::string> walked;
+        std::size_t gapped_runs = 0;
+        rv.for_each_chunk([&](const std::string* data, std::size_t n)
+            {
+                walked.insert(walked.end(), data, data + n);
+                ++gapped_runs;
+            });
+        CHECK(walked == ref);
+
+        rv.set_editing_mode(false);
+        CHECK(!rv.editing_mode());
+        CHECK(same(rv, ref));
+        std::size_t packed_runs = 0;
+        rv.for_each_chunk([&packed_runs](const std::string*, std::size_t) { ++packed_runs; });
+        CHECK(packed_runs < gapped_runs);
+    }
+
+    // growth at the front: prepends fill chunks from the right, and a FIFO built from
+    // push_back and erase_front only holds the chunks it is using
+    void front_growth_and_fifo()
+    {
+        rvec::rope_vector<int, 32> rv;
+        std::deque<int> ref;
+        for (int i = 0; i < 5000; ++i)
+        {
+            rv.insert(0, i);
+            ref.push_front(i);
+        }
+        CHECK(same(rv, ref));
+        CHECK(rv.fragmentation() < 0.5);
+
+        rvec::rope_vector<int, 32> queue;
+        std::deque<int> queue_ref;
+        std::size_t peak = 0;
+        for (int i = 0; i < 100000; ++i)
+        {
+            queue.push_back(i);
+            queue_ref.push_back(i);
+            if (i % 3 != 0)
+            {
+                CHECK(queue.front() == queue_ref.front());
+                queue.erase_front();
+                queue_ref.pop_front();
+            }
+            if (queue_ref.size() > 200)
+            {
+                queue.erase_front();
+                queue_ref.pop_front();
+            }
+            peak = std::max(peak, queue.memory_used());
+        }
+        CHECK(same(queue, queue_ref));
+        CHECK(peak <= 16 * 32 * sizeof(int));
+    }
+
+    // counts live instances, and has no default constructor
+    struct tracked
+    {
+        static int live;
+        int value;
+
+        explicit tracked(int v)
+            : value(v)
+        {
+            ++live;
+        }
+
+        tracked(const tracked& other)
+            : value(other.value)
+        {
+            ++live;
+        }
+
+        tracked(tracked&& other) noexcept
+            : value(other.value)
+        {
+            ++live;
+        }
+
+        tracked& operator=(const tracked&) = default;
+        tracked& operator=(tracked&&) noexcept = default;
+
+        ~tracked()
+        {
+            --live;
+        }
+
+        bool operator==(const tracked& other) const
+        {
+            return value == other.value;
+        }
+    };
+
+    int tracked::live = 0;
+
+    // chunks hold raw storage: reserving constructs nothing, and every element constructed
+    // by an edit is destroyed exactly once
+    void elements_live_only_while_stored()
+    {
+        {
+            rvec::rope_vector<tracked, 16> rv;
+            rv.reserve(1000);
+            CHECK(rv.capacity() >= 1000);
+            CHECK(tracked::live == 0);
+
+            for (int i = 0; i < 300; ++i)
+            {
+                rv.emplace_back(i);
+            }
+            CHECK(tracked::live == 300);
+            rv.insert(10, tracked(-1));
+            rv.emplace(100, -2);
+            rv.erase(5);
+            rv.erase(20, 60);
+            CHECK(tracked::live == static_cast<int>(rv.size()));
+            CHECK(rv[9].value == -1);
+
+            // a copy shares the chunks until it is unshared
+            rvec::rope_vector<tracked, 16> copy = rv;
+            CHECK(tracked::live == static_cast<int>(rv.size()));
+            copy.unshare();
+            CHECK(tracked::live == static_cast<int>(2 * rv.size()));
+            copy.erase_front();
+            CHECK(tracked::live == static_cast<int>(rv.size() + copy.size()));
+
+            rv.erase(50, rv.size());
+            rv.shrink_to_fit();
+            CHECK(tracked::live == static_cast<int>(rv.size() + copy.size()));
+            rv.clear();
+            CHECK(tracked::live == static_cast<int>(copy.size()));
+        }
+        CHECK(tracked::live == 0);
+    }
+
+    struct point
+    {
+        int x;
+        int y;
+
+        bool operator==(const point& other) const
+        {
+            return x == other.x && y == other.y;
+        }
+    };
+
+    // trivially copyable elements take the memmove/memcpy paths for shifts, gap moves,
+    // repacking and chunk copies
+    void trivially_copyable_paths_match_model()
+    {
+        static_assert(std::is_trivially_copyable<point>::value, "point must take the memmove paths");
+        rvec::rope_vector<point, 64> rv;
+        std::vector<point> ref;
+        std::mt19937 rng(5);
+        for (int i = 0; i < 3000; ++i)
+        {
+            point p{ i, -i };
+            std::size_t pos = rng() % (ref.size() + 1);
+            rv.insert(pos, p);
+            ref.insert(ref.begin() + static_cast<std::ptrdiff_t>(pos), p);
+            if (i % 4 == 3)
+            {
+                std::size_t gone = rng() % ref.size();
+                rv.erase(gone);
+                ref.erase(ref.begin() + static_cast<std::ptrdiff_t>(gone));
+            }
+        }
+        CHECK(same(rv, ref));
+
+        rv.set_editing_mode(true);
+        for (int i = 0; i < 100; ++i)
+        {
+            rv.insert(1000 + static_cast<std::size_t>(i), point{ 7, i });
+            ref.insert(ref.begin() + 1000 + i, point{ 7, i });
+        }
+        rv.set_editing_mode(false);
+        CHECK(same(rv, ref));
+
+        rvec::rope_vector<point, 64> copy = rv;
+        copy[0] = point{ 0, 1 };
+        copy.shrink_to_fit();
+        CHECK(same(rv, ref));
+        CHECK(copy[0] == (point{ 0, 1 }));
+        CHECK(copy.size() == ref.size());
+        CHECK(std::equal(copy.begin() + 1, copy.end(), ref.begin() + 1));
+    }
+
+    // memory_resource that counts what is outstanding
+    class counting_resource : public std::pmr::memory_resource
+    {
+    public:
+        std::size_t outstanding = 0;
+        std::size_t calls = 0;
+
+    private:
+        void* do_allocate(std::size_t bytes, std::size_t align) override
+        {
+            outstanding += bytes;
+            ++calls;
+            return std::pmr::new_delete_resource()->allocate(bytes, align);
+        }
+
+        void do_deallocate(void* p, std::size_t bytes, std::size_t align) override
+        {
+            outstanding -= bytes;
+            std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+        {
+            return this == &other;
+        }
+    };
+
+    // a stateful allocator over a counting_resource that moves with the container it is in
+    template <typename T>
+    struct moving_allocator
+    {
+        using value_type = T;
+        using propagate_on_container_move_assignment = std::true_type;
+
+        counting_resource* resource;
+
+        explicit moving_allocator(counting_resource* r)
+            : resource(r)
+        {
+        }
+
+        template <typename U>
+        moving_allocator(const moving_allocator<U>& other)
+            : resource(other.resource)
+        {
+        }
+
+        T* allocate(std::size_t n)
+        {
+            return static_cast<T*>(resource->allocate(n * sizeof(T), alignof(T)));
+        }
+
+        void deallocate(T* p, std::size_t n)
+        {
+            resource->deallocate(p, n * sizeof(T), alignof(T));
+        }
+
+        template <typename U>
+        bool operator==(const moving_allocator<U>& other) const
+        {
+            return resource == other.resource;
+        }
+
+        template <typename U>
+        bool operator!=(const moving_allocator<U>& other) const
+        {
+            return resource != other.resource;
+        }
+    };
+
+    // chunks and branches come from the container's allocator and all of it goes back;
+    // moving elements between containers on different resources copies them across
+    void allocator_owns_every_block()
+    {
+        counting_resource first;
+        counting_resource second;
+        {
+            rvec::pmr::rope_vector<int, 32> a(&first);
+            for (int i = 0; i < 5000; ++i)
+            {
+                a.push_back(i);
+            }
+            CHECK(first.calls != 0);
+            CHECK(first.outstanding != 0);
+            CHECK(a.get_allocator().resource() == &first);
+
+            rvec::pmr::rope_vector<int, 32> b(&second);
+            for (int i = 0; i < 100; ++i)
+            {
+                b.push_back(-i);
+            }
+            b.append(std::move(a));
+            CHECK(b.size() == 5100);
+            CHECK(b[100] == 0 && b[5099] == 4999);
+            CHECK(a.empty());
+
+            // trimmed, a holds no chunk or branch; only its spare list's buffer remains
+            a.trim();
+            CHECK(first.outstanding < 32 * sizeof(int));
+        }
+        CHECK(first.outstanding == 0);
+        CHECK(second.outstanding == 0);
+
+        // a move assignment that takes the other side's allocator first returns its own
+        // cached chunks and branches to the allocator they came from
+        {
+            using moving = rvec::rope_vector<int, 32, moving_allocator<int>>;
+            moving a{ moving_allocator<int>(&first) };
+            a.set_spare_limit(8);
+            for (int i = 0; i < 1000; ++i)
+            {
+                a.push_back(i);
+            }
+            a.clear();
+            CHECK(a.memory_used() != 0);
+
+            moving b{ moving_allocator<int>(&second) };
+            for (int i = 0; i < 1000; ++i)
+            {
+                b.push_back(-i);
+            }
+            a = std::move(b);
+            CHECK(a.get_allocator().resource == &second);
+            CHECK(a.size() == 1000 && a[999] == -999);
+            CHECK(first.outstanding < 32 * sizeof(int));
+        }
+        CHECK(first.outstanding == 0);
+        CHECK(second.outstanding == 0);
+    }
+
+    // retired chunks are cached up to the spare limit, so a steady push/pop workload stops
+    // calling the allocator once it is warm
+    void spare_chunks_are_recycled()
+    {
+        counting_resource resource;
+        rvec::pmr::rope_vector<int, 32> rv(&resource);
+        rv.set_spare_limit(4);
+        CHECK(rv.spare_limit() == 4);
+        for (int round = 0; round < 4; ++round)
+        {
+            for (int i = 0; i < 256; ++i)
+            {
+                rv.push_back(i);
+            }
+            while (!rv.empty())
+            {
+                rv.erase_front();
+            }
+        }
+
+        std::size_t warm = resource.calls;
+        for (int round = 0; round < 100; ++round)
+        {
+            for (int i = 0; i < 64; ++i)
+            {
+                rv.push_back(i);
+            }
+            for (int i = 0; i < 64; ++i)
+            {
+                CHECK(rv.front() == i);
+                rv.erase_front();
+            }
+        }
+        CHECK(resource.calls == warm);
+
+        std::size_t cached = rv.memory_used();
+        CHECK(cached != 0);
+        rv.trim();
+        CHECK(rv.memory_used() == 0);
+        CHECK(rv.spare_limit() == 4);
+    }
+
+    // iterators step within a chunk and jump across seams and editing gaps; arithmetic,
+    // differences and ordering agree with the indices
+    void iterators_agree_with_indices()
+    {
+        rvec::rope_vector<int, 16> rv;
+        for (int i = 0; i < 1000; ++i)
+        {
+            rv.push_back(2 * i);
+        }
+        rv.set_editing_mode(true);
+        rv.insert(500, 999);
+        rv.erase(500);
+        rv.insert(37, 73);
+        rv.erase(37);
+
+        auto first = rv.begin();
+        CHECK(rv.end() - first == 1000);
+        std::mt19937 rng(9);
+        bool agree = true;
+        for (int step = 0; step < 2000; ++step)
+        {
+            std::ptrdiff_t i = static_cast<std::ptrdiff_t>(rng() % 1000);
+            std::ptrdiff_t j = static_cast<std::ptrdiff_t>(rng() % 1000);
+            auto a = first + i;
+            auto b = a + (j - i);
+            agree = agree && *a == 2 * i && *b == 2 * j && b - a == j - i && first[j] == 2 * j;
+            agree = agree && (a < b) == (i < j) && (a == b) == (i == j);
+        }
+        CHECK(agree);
+
+        int expected = 0;
+        for (auto it = rv.begin(); it != rv.end(); ++it, expected += 2)
+        {
+            agree = agree && *it == expected;
+        }
+        for (auto it = rv.rbegin(); it != rv.rend(); ++it)
+        {
+            expected -= 2;
+            agree = agree && *it == expected;
+        }
+        CHECK(agree);
+
+        const rvec::rope_vector<int, 16>& view = rv;
+        auto found = std::lower_bound(view.cbegin(), view.cend(), 1234);
+        CHECK(found - view.cbegin() == 617);
+        CHECK(std::distance(view.crbegin(), view.crend()) == 1000);
+
+        // writes through iterators land in the container
+        for (auto it = rv.begin(); it != rv.end(); ++it)
+        {
+            *it += 1;
+        }
+        CHECK(rv[0] == 1 && rv[999] == 1999);
+    }
+
+    // whole chunks change owner; the chunk holding a cut point is the only one split
+    void splice_append_and_split()
+    {
+        std::mt19937 rng(17);
+        rvec::rope_vector<std::string, 16> rv;
+        std::vector<std::string> ref;
+        for (int i = 0; i < 500; ++i)
+        {
+            rv.push_back(std::to_string(i));
+            ref.push_back(std::to_string(i));
+        }
+
+        for (int round = 0; round < 50; ++round)
+        {
+            std::size_t pos = rng() % (ref.size() + 1);
+            rvec::rope_vector<std::string, 16> tail = rv.split_off(pos);
+            CHECK(rv.size() == pos);
+            CHECK(tail.size() == ref.size() - pos);
+
+            rvec::rope_vector<std::string, 16> extra;
+            std::vector<std::string> ref_extra;
+            for (int i = 0; i < round; ++i)
+            {
+                extra.push_back("r" + std::to_string(round) + "." + std::to_string(i));
+                ref_extra.push_back("r" + std::to_string(round) + "." + std::to_string(i));
+            }
+            rv.append(std::move(tail));
+            CHECK(tail.empty());
+            std::size_t at = rng() % (ref.size() + 1);
+            rv.splice(at, std::move(extra));
+            ref.insert(ref.begin() + static_cast<std::ptrdiff_t>(at), ref_extra.begin(), ref_extra.end());
+        }
+        CHECK(same(rv, ref));
+
+        rvec::rope_vector<std::string, 16> all = rv.split_off(0);
+        CHECK(rv.empty());
+        CHECK(same(all, ref));
+    }
+
+    // counts outstanding blocks, and throws once the budget of allocations runs out
+    struct budget
+    {
+        static long left; // allocations still allowed, or -1 for no limit
+        static long outstanding;
+    };
+
+    long budget::left = -1;
+    long budget::outstanding = 0;
+
+    template <typename T>
+    struct failing_allocator
+    {
+        using value_type = T;
+
+        failing_allocator() = default;
+
+        template <typename U>
+        failing_allocator(const failing_allocator<U>&)
+        {
+        }
+
+        T* allocate(std::size_t n)
+        {
+            if (budget::left == 0)
+            {
+                throw std::bad_alloc();
+            }
+            if (budget::left > 0)
+            {
+                --budget::left;
+            }
+            ++budget::outstanding;
+            return std::allocator<T>().allocate(n);
+        }
+
+        void deallocate(T* p, std::size_t n)
+        {
+            --budget::outstanding;
+            std::allocator<T>().deallocate(p, n);
+        }
+
+        template <typename U>
+        bool operator==(const failing_allocator<U>&) const
+        {
+            return true;
+        }
+
+        template <typename U>
+        bool operator!=(const failing_allocator<U>&) const
+        {
+            return false;
+        }
+    };
+
+    using fragile = rvec::rope_vector<std::string, 8, failing_allocator<std::string>>;
+
+    fragile fragmented(int n)
+    {
+        fragile rv;
+        rv.set_spare_limit(0);
+        for (int i = 0; i < n; ++i)
+        {
+            rv.push_back(std::to_string(i) + " long enough to live on the heap");
+        }
+        for (int i = n - 1; i > 0; i -= 3)
+        {
+            rv.erase(static_cast<std::size_t>(i));
+        }
+        return rv;
+    }
+
+    // when the allocator gives out part way, shrink_to_fit, split_off and append leave a
+    // valid container, either unchanged or empty, and leak nothing
+    void restructuring_survives_allocation_failure()
+    {
+        for (long allowed = 0; allowed < 40; ++allowed)
+        {
+            {
+                fragile rv = fragmented(300);
+                const fragile before = rv;
+                budget::left = allowed;
+                try
+                {
+                    rv.shrink_to_fit();
+                }
+                catch (const std::bad_alloc&)
+                {
+                }
+                budget::left = -1;
+                CHECK(rv == before || rv.empty());
+
+                for (std::size_t pos : { std::size_t(0), std::size_t(57), std::size_t(150) })
+                {
+                    fragile whole = fragmented(300);
+                    budget::left = allowed;
+                    try
+                    {
+                        fragile tail = whole.split_off(pos);
+                        budget::left = -1;
+                        CHECK(whole.size() == pos && tail.size() == before.size() - pos);
+                        whole.append(std::move(tail));
+                    }
+                    catch (const std::bad_alloc&)
+                    {
+                    }
+                    budget::left = -1;
+                    CHECK(whole == before || whole.empty());
+                }
+
+                fragile front = fragmented(300);
+                fragile back = fragmented(300);
+                budget::left = allowed;
+                bool appended = true;
+                try
+                {
+                    front.append(std::move(back));
+                }
+                catch (const std::bad_alloc&)
+                {
+                    appended = false;
+                }
+                budget::left = -1;
+                if (appended)
+                {
+                    CHECK(front.size() == 2 * before.size());
+                    CHECK(std::equal(front.begin(), front.begin() + static_cast<std::ptrdiff_t>(before.size()), before.begin()));
+                }
+                else
+                {
+                    CHECK(front == before || front.empty());
+                }
+            }
+            CHECK(budget::outstanding == 0);
+        }
+
+        // reserve leaks nothing when it runs out part way, and caching released chunks never
+        // allocates, so a container is destroyed even while its allocator is failing
+        {
+            fragile rv;
+            for (int i = 0; i < 100; ++i)
+            {
+                rv.push_back(std::to_string(i));
+            }
+            for (long allowed = 0; allowed < 4; ++allowed)
+            {
+                budget::left = allowed;
+                try
+                {
+                    rv.reserve(rv.capacity() + 100);
+                }
+                catch (const std::bad_alloc&)
+                {
+                }
+            }
+            budget::left = 0;
+        }
+        budget::left = -1;
+        CHECK(budget::outstanding == 0);
+    }
+
+    // copies share chunks until one side writes; every write path must copy the chunk it
+    // touches first, so the other copies never see it
+    void copies_share_until_written()
+    {
+        using strings = rvec::rope_vector<std::string, 8>;
+        std::mt19937 rng(18);
+        for (int round = 0; round < 100; ++round)
+        {
+            strings a;
+            a.set_editing_mode(rng() % 2 != 0);
+            std::vector<std::string> ra;
+            for (std::size_t i = 0, n = rng() % 200 + 1; i < n; ++i)
+            {
+                ra.push_back(std::to_string(rng()));
+                a.push_back(ra.back());
+            }
+
+            strings b(a);
+            strings c;
+            c.push_back("replaced");
+            c = b;
+            CHECK(&*a.cbegin() == &*b.cbegin());
+            CHECK(&*b.cbegin() == &*c.cbegin());
+            std::vector<std::string> rb = ra;
+            std::vector<std::string> rc = ra;
+
+            for (int step = 0; step < 40; ++step)
+            {
+                unsigned which = rng() % 3;
+                strings& rv = which == 0 ? a : which == 1 ? b : c;
+                std::vector<std::string>& ref = which == 0 ? ra : which == 1 ? rb : rc;
+                unsigned op = rng() % 7;
+                if (op == 0 || ref.empty())
+                {
+                    std::size_t pos = rng() % (ref.size() + 1);
+                    rv.insert(pos, "ins");
+                    ref.insert(ref.begin() + static_cast<std::ptrdiff_t>(pos), "ins");
+                }
+                else if (op == 1)
+                {
+                    std::size_t pos = rng() % ref.size();
+                    rv.erase(pos);
+                    ref.erase(ref.begin() + static_cast<std::ptrdiff_t>(pos));
+                }
+                else if (op == 2)
+                {
+                    std::size_t pos = rng() % ref.size();
+                    rv[pos] = "set";
+                    ref[pos] = "set";
+                }
+                else if (op == 3)
+                {
+                    std::size_t pos = rng() % ref.size();
+                    *(rv.begin() + static_cast<std::ptrdiff_t>(pos)) = "it";
+                    ref[pos] = "it";
+                }
+                else if (op == 4)
+                {
+                    rv.erase_front();
+                    ref.erase(ref.begin());
+                }
+                else if (op == 5)
+                {
+                    rv.for_each_chunk([](std::string* data, std::size_t n) {
+                        for (std::size_t i = 0; i < n; ++i)
+                        {
+                            data[i] += "!";
+                        }
+                    });
+                    for (std::string& s : ref)
+                    {
+                        s += "!";
+                    }
+                }
+                else
+                {
+                    std::size_t n = rng() % (ref.size() + 5);
+                    rv.resize(n);
+                    ref.resize(n);
+                }
+                CHECK(same(a, ra));
+                CHECK(same(b, rb));
+                CHECK(same(c, rc));
+            }
+
+            strings d = a;
+            d.shrink_to_fit();
+            strings e = b;
+            e.append(e.split_off(e.size() / 2));
+            CHECK(same(d, ra) && same(a, ra));
+            CHECK(same(e, rb) && same(b, rb));
+        }
+    }
+
+    // unshare() gives a copy private chunks up front, after which writes allocate nothing.
+    // a copy only shares chunks with an equal allocator, so b is assigned on the same resource
+    void unshare_takes_private_chunks()
+    {
+        counting_resource resource;
+        rvec::pmr::rope_vector<int, 32> a(&resource);
+        for (int i = 0; i < 1000; ++i)
+        {
+            a.push_back(i);
+        }
+
+        std::size_t before = resource.calls;
+        rvec::pmr::rope_vector<int, 32> b(&resource);
+        b = a;
+        CHECK(&*a.cbegin() == &*b.cbegin());
+        b.unshare();
+        CHECK(&*a.cbegin() != &*b.cbegin());
+        CHECK(resource.calls > before);
+
+        std::size_t shared = resource.calls;
+        for (int i = 0; i < 1000; ++i)
+        {
+            b[static_cast<std::size_t>(i)] = -i;
+        }
+        CHECK(resource.calls == shared);
+        for (int i = 0; i < 1000; ++i)
+        {
+            CHECK(a[static_cast<std::size_t>(i)] == i);
+            CHECK(b[static_cast<std::size_t>(i)] == -i);
+        }
+    }
+
+    // copies handed to other threads are read and written there while the original changes
+    void copies_cross_threads()
+    {
+        rvec::rope_vector<int, 64> a;
+        for (int i = 0; i < 100000; ++i)
+        {
+            a.push_back(i);
+        }
+        std::vector<rvec::rope_vector<int, 64>> copies(4, a);
+        std::vector<long long> sums(copies.size());
+        std::vector<std::thread> threads;
+        for (std::size_t t = 0; t < copies.size(); ++t)
+        {
+            threads.emplace_back([&copies, &sums, t] {
+                rvec::rope_vector<int, 64>& mine = copies[t];
+                for (std::size_t i = 0; i < mine.size(); i += 7)
+                {
+                    mine[i] += 1;
+                }
+                for (auto it = mine.cbegin(); it != mine.cend(); ++it)
+                {
+                    sums[t] += *it;
+                }
+                mine.clear();
+            });
+        }
+        for (std::size_t i = 0; i < a.size(); i += 3)
+        {
+            a[i] = -1;
+        }
+        for (std::thread& t : threads)
+        {
+            t.join();
+        }
+
+        long long expected = 100000LL * 99999 / 2 + (100000 + 6) / 7;
+        for (long long s : sums)
+        {
+            CHECK(s == expected);
+        }
+        for (std::size_t i = 0; i < a.size(); ++i)
+        {
+            CHECK(a[i] == (i % 3 == 0 ? -1 : static_cast<int>(i)));
+        }
+    }
+
+    // one recorded edit inside a group, applied to both rv and its model
+    void grouped_edit(rvec::rope_vector<std::string, 8>& rv, std::vector<std::string>& ref, std::mt19937& rng)
+    {
+        unsigned op = rng() % 9;
+        if (op == 0 || ref.empty())
+        {
+            std::size_t pos = rng() % (ref.size() + 1);
+            std::string value = std::to_string(rng() % 1000);
+            rv.insert(pos, value);
+            ref.insert(ref.begin() + static_cast<std::ptrdiff_t>(pos), value);
+        }
+        else if (op == 1)
+        {
+            std::size_t pos = rng() % ref.size();
+            rv.erase(pos);
+            ref.erase(ref.begin() + static_cast<std::ptrdiff_t>(pos));
+        }
+        else if (op == 2)
+        {
+            rv.erase_front();
+            ref.erase(ref.begin());
+        }
+        else if (op == 3)
+        {
+            rv.push_back("back");
+            ref.push_back("back");
+        }
+        else if (op == 4)
+        {
+            std::size_t n = rng() % (ref.size() + 20);
+            rv.resize(n);
+            ref.resize(n);
+        }
+        else if (op == 5)
+        {
+            if (rng() % 4 == 0)
+            {
+                rv.clear();
+                ref.clear();
+            }
+        }
+        else if (op == 6)
+        {
+            rvec::rope_vector<std::string, 8> other;
+            std::vector<std::string> added;
+            for (std::size_t i = 0, n = rng() % 40; i < n; ++i)
+            {
+                added.push_back("o" + std::to_string(i));
+                other.push_back(added.back());
+            }
+            std::size_t pos = rng() % (ref.size() + 1);
+            if (rng() % 2 == 0)
+            {
+                rv.splice(pos, std::move(other));
+                ref.insert(ref.begin() + static_cast<std::ptrdiff_t>(pos), added.begin(), added.end());
+            }
+            else
+            {
+                rv.append(std::move(other));
+                ref.insert(ref.end(), added.begin(), added.end());
+            }
+        }
+        else if (op == 7)
+        {
+            // the split-off tail is changed afterwards; undo must not see that
+            std::size_t pos = rng() % (ref.size() + 1);
+            rvec::rope_vector<std::string, 8> tail = rv.split_off(pos);
+            CHECK(same(tail, std::vector<std::string>(ref.begin() + static_cast<std::ptrdiff_t>(pos), ref.end())));
+            ref.resize(pos);
+            if (!tail.empty())
+            {
+                tail[0] = "changed";
+            }
+        }
+        else
+        {
+            std::size_t pos = rng() % ref.size();
+            std::vector<std::string> values(rng() % (ref.size() - pos + 1));
+            for (std::string& s : values)
+            {
+                s = "r" + std::to_string(rng() % 100);
+            }
+            rv.replace(pos, values.begin(), values.end());
+            std::copy(values.begin(), values.end(), ref.begin() + static_cast<std::ptrdiff_t>(pos));
+        }
+    }
+
+    // random groups of recorded edits, some nested, interleaved with undo and redo; after
+    // each step rv matches the model state the history says it should be in
+    void undo_redo_match_model()
+    {
+        std::mt19937 rng(20);
+        for (int round = 0; round < 100; ++round)
+        {
+            rvec::rope_vector<std::string, 8> rv;
+            rv.set_editing_mode(rng() % 2 != 0);
+            std::vector<std::string> ref;
+            for (std::size_t i = 0, n = rng() % 100; i < n; ++i)
+            {
+                ref.push_back(std::to_string(rng() % 1000));
+                rv.push_back(ref.back());
+            }
+
+            std::vector<std::vector<std::string>> undo_states;
+            std::vector<std::vector<std::string>> redo_states;
+            for (int step = 0; step < 40; ++step)
+            {
+                unsigned action = rng() % 10;
+                if (action < 6)
+                {
+                    std::vector<std::string> before = ref;
+                    rv.begin_group();
+                    rv.push_back("g");
+                    ref.push_back("g");
+                    for (unsigned k = 0, n = rng() % 6 + 1; k < n; ++k)
+                    {
+                        grouped_edit(rv, ref, rng);
+                        if (rng() % 5 == 0)
+                        {
+                            rv.begin_group();
+                            grouped_edit(rv, ref, rng);
+                            rv.end_group();
+                        }
+                    }
+                    rv.end_group();
+                    undo_states.push_back(before);
+                    redo_states.clear();
+                }
+                else if (action < 8)
+                {
+                    bool undone = rv.undo();
+                    CHECK(undone == !undo_states.empty());
+                    if (undone)
+                    {
+                        redo_states.push_back(ref);
+                        ref = undo_states.back();
+                        undo_states.pop_back();
+                    }
+                }
+                else
+                {
+                    bool redone = rv.redo();
+                    CHECK(redone == !redo_states.empty());
+                    if (redone)
+                    {
+                        undo_states.push_back(ref);
+                        ref = redo_states.back();
+                        redo_states.pop_back();
+                    }
+                }
+                CHECK(same(rv, ref));
+                CHECK(rv.can_undo() == !undo_states.empty());
+                CHECK(rv.can_redo() == !redo_states.empty());
+            }
+        }
+    }
+
+    // what keeps and what drops the history
+    void history_rules()
+    {
+        rvec::rope_vector<int, 4> rv;
+        CHECK(!rv.undo() && !rv.redo());
+
+        // an empty group leaves nothing to undo
+        rv.begin_group();
+        rv.end_group();
+        CHECK(!rv.can_undo());
+
+        // nested groups undo as one step
+        rv.begin_group();
+        rv.push_back(1);
+        rv.begin_group();
+        rv.push_back(2);
+        rv.end_group();
+        CHECK(!rv.can_undo());
+        rv.end_group();
+        CHECK(rv.undo());
+        CHECK(rv.empty() && !rv.can_undo());
+        CHECK(rv.redo());
+        CHECK(same(rv, std::vector<int>{ 1, 2 }));
+
+        // a new recorded edit drops what could be redone
+        CHECK(rv.undo());
+        rv.begin_group();
+        rv.push_back(3);
+        rv.end_group();
+        CHECK(!rv.can_redo());
+        CHECK(same(rv, std::vector<int>{ 3 }));
+
+        // writes through a reference are not recorded and keep the history
+        rv[0] = 4;
+        CHECK(rv.can_undo());
+
+        // a recorded kind of edit outside a group discards it all
+        rv.push_back(5);
+        CHECK(!rv.can_undo() && !rv.can_redo());
+
+        // swap exchanges the histories along with the elements
+        rvec::rope_vector<int, 4> other;
+        other.begin_group();
+        other.push_back(9);
+        other.end_group();
+        rv.swap(other);
+        CHECK(rv.can_undo() && !other.can_undo());
+        CHECK(rv.undo() && rv.empty());
+        CHECK(same(other, std::vector<int>{ 4, 5 }));
+
+        rv.begin_group();
+        rv.push_back(7);
+        rv.end_group();
+        rv.discard_history();
+        CHECK(!rv.can_undo());
+
+        // undo keeps move-only elements it takes out of the container
+        rvec::rope_vector<std::unique_ptr<int>, 4> owners;
+        owners.begin_group();
+        for (int i = 0; i < 10; ++i)
+        {
+            owners.push_back(std::make_unique<int>(i));
+        }
+        owners.erase(3);
+        owners.end_group();
+        CHECK(owners.undo() && owners.empty());
+        CHECK(owners.redo());
+        CHECK(owners.size() == 9 && *owners[3] == 4);
+
+        // the history is drawn from the container's allocator, like its chunks
+        {
+            fragile drawn;
+            drawn.push_back("kept");
+            budget::left = 0;
+            bool thrown = false;
+            try
+            {
+                drawn.begin_group();
+            }
+            catch (const std::bad_alloc&)
+            {
+                thrown = true;
+            }
+            budget::left = -1;
+            CHECK(thrown);
+
+            drawn.begin_group();
+            drawn.push_back("added");
+            drawn.erase(0);
+            drawn.end_group();
+            CHECK(drawn.undo());
+            CHECK(drawn.size() == 1 && drawn[0] == "kept");
+        }
+        CHECK(budget::outstanding == 0);
+    }
+
+    // a paste of a large container is undone and redone without copying its elements
+    void large_paste_undoes()
+    {
+        rvec::rope_vector<int, 256> rv;
+        for (int i = 0; i < 1000; ++i)
+        {
+            rv.push_back(i);
+        }
+        rvec::rope_vector<int, 256> big;
+        for (int i = 0; i < 1000000; ++i)
+        {
+            big.push_back(-i);
+        }
+        rv.begin_group();
+        rv.splice(500, std::move(big));
+        rv.end_group();
+        CHECK(rv.size() == 1001000);
+        CHECK(rv.undo());
+        CHECK(rv.size() == 1000 && rv[500] == 500);
+        CHECK(rv.redo());
+        CHECK(rv.size() == 1001000 && rv[501] == -1 && rv[1000500] == 500);
+    }
+
+    // a random batch of edits against the model of applying them to the original positions:
+    // inserts at a position in batch order, then the old element unless it is erased
+    void batched_edits_match_model()
+    {
+        using strings = rvec::rope_vector<std::string, 16>;
+        std::mt19937 rng(21);
+        for (int round = 0; round < 200; ++round)
+        {
+            strings rv;
+            rv.set_editing_mode(rng() % 2 != 0);
+            std::vector<std::string> ref;
+            for (std::size_t i = 0, n = rng() % 300; i < n; ++i)
+            {
+                ref.push_back(std::to_string(i));
+                rv.push_back(ref.back());
+            }
+
+            std::vector<strings::edit> edits;
+            std::vector<std::vector<std::string>> inserted(ref.size() + 1);
+            std::vector<bool> erased(ref.size());
+            std::size_t span = ref.size() + 1;
+            std::size_t base = rng() % span;
+            for (std::size_t k = 0, n = rng() % 40 + 1; k < n; ++k)
+            {
+                // edits mostly cluster near one spot, as a find-and-replace pass would
+                std::size_t pos = rng() % 4 == 0 ? rng() % span : std::min(ref.size(), base + rng() % 20);
+                if (pos < ref.size() && !erased[pos] && rng() % 3 == 0)
+                {
+                    erased[pos] = true;
+                    edits.push_back({ strings::edit::erase, pos, {} });
+                }
+                else
+                {
+                    std::string value = "e" + std::to_string(k);
+                    inserted[pos].push_back(value);
+                    edits.push_back({ strings::edit::insert, pos, value });
+                }
+            }
+
+            std::vector<std::string> expected;
+            for (std::size_t i = 0; i <= ref.size(); ++i)
+            {
+                expected.insert(expected.end(), inserted[i].begin(), inserted[i].end());
+                if (i < ref.size() && !erased[i])
+                {
+                    expected.push_back(ref[i]);
+                }
+            }
+
+            rv.begin_group();
+            std::size_t moved = rv.apply_edits(edits);
+            rv.end_group();
+            CHECK(moved <= ref.size());
+            CHECK(same(rv, expected));
+            CHECK(rv.undo());
+            CHECK(same(rv, ref));
+            CHECK(!rv.can_undo());
+            CHECK(rv.redo());
+            CHECK(same(rv, expected));
+        }
+    }
+
+    // chunks no edit lands in are left alone, so a batch near the end moves little
+    void batched_edits_touch_only_their_chunks()
+    {
+        using ints = rvec::rope_vector<int, 64>;
+        ints rv;
+        for (int i = 0; i < 100000; ++i)
+        {
+            rv.push_back(i);
+        }
+        std::vector<ints::edit> edits{ { ints::edit::insert, 99990, -1 }, { ints::edit::erase, 99995, 0 }, { ints::edit::insert, 100000, -2 } };
+        std::size_t moved = rv.apply_edits(edits.begin(), edits.end());
+        CHECK(moved <= 2 * 64);
+        CHECK(rv.size() == 100001);
+        CHECK(rv[99989] == 99989 && rv[99990] == -1 && rv[99991] == 99990);
+        CHECK(rv[99995] == 99994 && rv[99996] == 99996);
+        CHECK(rv.back() == -2);
+        CHECK(rv[0] == 0 && rv[50000] == 50000);
+
+        std::vector<ints::edit> none;
+        CHECK(rv.apply_edits(none) == 0);
+        CHECK(rv.size() == 100001);
+    }
+
+    // range and fill inserts and range erases at random positions against a model
+    void range_edits_match_model()
+    {
+        std::mt19937 rng(22);
+        for (int round = 0; round < 100; ++round)
+        {
+            rvec::rope_vector<std::string, 16> rv;
+            rv.set_editing_mode(rng() % 2 != 0);
+            std::vector<std::string> ref;
+            for (int step = 0; step < 60; ++step)
+            {
+                unsigned op = rng() % 5;
+                std::size_t pos = rng() % (ref.size() + 1);
+                if (op == 0)
+                {
+                    std::vector<std::string> values(rng() % 50);
+                    for (std::string& s : values)
+                    {
+                        s = std::to_string(rng() % 1000);
+                    }
+                    rv.insert(pos, values.begin(), values.end());
+                    ref.insert(ref.begin() + static_cast<std::ptrdiff_t>(pos), values.begin(), values.end());
+                }
+                else if (op == 1)
+                {
+                    // single-pass input
+                    std::istringstream in("a b c d e f g h i j k l m n o p q r s t");
+                    rv.insert(pos, std::istream_iterator<std::string>(in), std::istream_iterator<std::string>());
+                    in.clear();
+                    in.str("a b c d e f g h i j k l m n o p q r s t");
+                    ref.insert(ref.begin() + static_cast<std::ptrdiff_t>(pos), std::istream_iterator<std::string>(in), std::istream_iterator<std::string>());
+                }
+                else if (op == 2)
+                {
+                    std::size_t n = rng() % 40;
+                    rv.insert(pos, n, "fill");
+                    ref.insert(ref.begin() + static_cast<std::ptrdiff_t>(pos), n, "fill");
+                }
+                else if (op == 3)
+                {
+                    rv.emplace(pos, 3, 'x');
+                    ref.emplace(ref.begin() + static_cast<std::ptrdiff_t>(pos), 3, 'x');
+                }
+                else
+                {
+                    std::size_t last = pos + rng() % (ref.size() - pos + 1);
+                    rv.erase(pos, last);
+                    ref.erase(ref.begin() + static_cast<std::ptrdiff_t>(pos), ref.begin() + static_cast<std::ptrdiff_t>(last));
+                }
+                CHECK(same(rv, ref));
+            }
+        }
+    }
+
+    // copies and emplacing constructors throw once `copies_left` runs out
+    struct brittle
+    {
+        static int copies_left;
+        static int live;
+        std::string text;
+
+        explicit brittle(std::string s)
+            : text(std::move(s))
+        {
+            ++live;
+        }
+
+        brittle(int, int)
+        {
+            spend();
+            ++live;
+        }
+
+        brittle(const brittle& other)
+            : text(other.text)
+        {
+            spend();
+            ++live;
+        }
+
+        brittle(brittle&& other) noexcept
+            : text(std::move(other.text))
+        {
+            ++live;
+        }
+
+        brittle& operator=(const brittle&) = default;
+        brittle& operator=(brittle&&) noexcept = default;
+
+        ~brittle()
+        {
+            --live;
+        }
+
+        static void spend()
+        {
+            if (copies_left == 0)
+            {
+                throw std::runtime_error("brittle");
+            }
+            if (copies_left > 0)
+            {
+                --copies_left;
+            }
+        }
+    };
+
+    int brittle::copies_left = -1;
+    int brittle::live = 0;
+
+    // a copy or constructor throwing part way through an insert or emplace leaves the
+    // container as it was, with no element leaked or lost
+    void inserts_are_all_or_nothing()
+    {
+        std::vector<brittle> values;
+        for (int i = 0; i < 30; ++i)
+        {
+            values.emplace_back("v" + std::to_string(i));
+        }
+        for (std::size_t n : { std::size_t(5), std::size_t(13), std::size_t(37) })
+        {
+            for (std::size_t pos = 0; pos <= n; ++pos)
+            {
+                for (int allowed : { 0, 1, 15, 29 })
+                {
+                    for (int kind = 0; kind < 3; ++kind)
+                    {
+                        rvec::rope_vector<brittle, 8> rv;
+                        for (std::size_t i = 0; i < n; ++i)
+                        {
+                            rv.push_back(brittle(std::to_string(i)));
+                        }
+                        int before = brittle::live;
+                        brittle::copies_left = allowed;
+                        bool thrown = false;
+                        try
+                        {
+                            if (kind == 0)
+                            {
+                                rv.insert(pos, values.begin(), values.end());
+                            }
+                            else if (kind == 1)
+                            {
+                                rv.insert(pos, 30, values[0]);
+                            }
+                            else
+                            {
+                                rv.emplace(pos, 0, 0);
+                            }
+                        }
+                        catch (const std::runtime_error&)
+                        {
+                            thrown = true;
+                        }
+                        brittle::copies_left = -1;
+                        if (kind != 2)
+                        {
+                            CHECK(thrown);
+                        }
+                        else if (!thrown)
+                        {
+                            CHECK(rv.size() == n + 1);
+                            rv.erase(pos);
+                        }
+                        CHECK(rv.size() == n);
+                        CHECK(brittle::live == before);
+                        for (std::size_t i = 0; i < rv.size(); ++i)
+                        {
+                            CHECK(rv[i].text == std::to_string(i));
+                        }
+                    }
+                }
+            }
+        }
+        values.clear();
+        CHECK(brittle::live == 0);
+    }
+
+    // counts the elements an edit moves
+    struct counted_moves
+    {
+        static int moves;
+        int value = 0;
+
+        counted_moves(int v)
+            : value(v)
+        {
+        }
+
+        counted_moves(const counted_moves& other) = default;
+
+        counted_moves(counted_moves&& other) noexcept
+            : value(other.value)
+        {
+            ++moves;
+        }
+
+        counted_moves& operator=(const counted_moves& other) = default;
+
+        counted_moves& operator=(counted_moves&& other) noexcept
+        {
+            value = other.value;
+            ++moves;
+            return *this;
+        }
+
+        bool operator==(const counted_moves& other) const
+        {
+            return value == other.value;
+        }
+    };
+
+    int counted_moves::moves = 0;
+
+    // an erase closes its hole from whichever side of the chunk holds fewer elements, and
+    // later erases near the same end stay cheap
+    void erase_moves_the_shorter_side()
+    {
+        rvec::rope_vector<counted_moves, 64> rv;
+        std::vector<counted_moves> ref;
+        for (int i = 0; i < 3 * 64; ++i)
+        {
+            rv.push_back(i);
+            ref.push_back(i);
+        }
+
+        auto erase = [&](std::size_t first, std::size_t last)
+        {
+            ref.erase(ref.begin() + static_cast<std::ptrdiff_t>(first), ref.begin() + static_cast<std::ptrdiff_t>(last));
+            counted_moves::moves = 0;
+            rv.erase(first, last);
+            return counted_moves::moves;
+        };
+
+        // near the front of the second chunk, then near the back of the third
+        CHECK(erase(64 + 1, 64 + 2) <= 1);
+        CHECK(erase(64 + 2, 64 + 3) <= 2);
+        CHECK(erase(126 + 60, 126 + 61) <= 3);
+        CHECK(erase(126 + 58, 126 + 59) <= 4);
+        CHECK(same(rv, ref));
+
+        // a run erased from a full chunk moves only the shorter remainder
+        CHECK(erase(10, 20) <= 10);
+        CHECK(same(rv, ref));
+
+        // the headroom that erase left at the front of the chunk takes the next prepend
+        ref.insert(ref.begin(), -1);
+        counted_moves::moves = 0;
+        rv.insert(0, -1);
+        CHECK(counted_moves::moves <= 1);
+        CHECK(same(rv, ref));
+    }
+
+    // random erases near both ends of every chunk, in both modes, against a model
+    void erases_near_chunk_ends_match_model()
+    {
+        std::mt19937 rng(23);
+        for (int round = 0; round < 50; ++round)
+        {
+            rvec::rope_vector<int, 16> rv;
+            rv.set_editing_mode(round % 2 != 0);
+            std::vector<int> ref;
+            for (int i = 0; i < 500; ++i)
+            {
+                rv.push_back(i);
+                ref.push_back(i);
+            }
+            while (ref.size() > 10)
+            {
+                std::size_t chunk = rng() % ((ref.size() + 15) / 16);
+                std::size_t pos = chunk * 16 + (rng() % 2 == 0 ? rng() % 3 : 15 - rng() % 3);
+                pos = std::min(pos, ref.size() - 1);
+                if (rng() % 4 == 0)
+                {
+                    std::size_t last = std::min(ref.size(), pos + rng() % 5);
+                    rv.erase(pos, last);
+                    ref.erase(ref.begin() + static_cast<std::ptrdiff_t>(pos), ref.begin() + static_cast<std::ptrdiff_t>(last));
+                }
+                else
+                {
+                    rv.erase(pos);
+                    ref.erase(ref.begin() + static_cast<std::ptrdiff_t>(pos));
+                }
+                if (rng() % 8 == 0)
+                {
+                    std::size_t at = rng() % (ref.size() + 1);
+                    rv.insert(at, -1);
+                    ref.insert(ref.begin() + static_cast<std::ptrdiff_t>(at), -1);
+                }
+            }
+            CHECK(same(rv, ref));
+        }
+    }
+
+    // a producer writes straight into the tail chunk, or a parked fresh one, and only what
+    // it commits becomes part of the container
+    void append_spans_commit_in_place()
+    {
+        rvec::rope_vector<int, 16> rv;
+        std::vector<int> ref;
+
+        auto span = rv.append_span(100);
+        CHECK(span.size() == 16);
+        rv.commit(0);
+        CHECK(rv.empty());
+
+        std::mt19937 rng(24);
+        for (int round = 0; round < 200; ++round)
+        {
+            std::size_t want = rng() % 40 + 1;
+            span = rv.append_span(want);
+            CHECK(span.size() != 0 && span.size() <= want);
+            CHECK(span.size() <= 16 - ref.size() % 16);
+            std::size_t written = rng() % (span.size() + 1);
+            for (std::size_t i = 0; i < written; ++i)
+            {
+                span.data()[i] = round * 100 + static_cast<int>(i);
+                ref.push_back(round * 100 + static_cast<int>(i));
+            }
+            rv.commit(written);
+            CHECK(rv.size() == ref.size());
+            if (round % 10 == 0)
+            {
+                rv.push_back(-round);
+                ref.push_back(-round);
+            }
+        }
+        CHECK(same(rv, ref));
+
+        // writing through the span of a copy leaves the original alone
+        rvec::rope_vector<int, 16> copy = rv;
+        span = copy.append_span(1);
+        span.data()[0] = -1;
+        copy.commit(1);
+        CHECK(copy.size() == ref.size() + 1 && copy.back() == -1);
+        CHECK(same(rv, ref));
+
+        // a commit inside a group is undone like a push_back
+        rv.begin_group();
+        span = rv.append_span(3);
+        std::fill(span.begin(), span.end(), 7);
+        rv.commit(span.size());
+        rv.end_group();
+        CHECK(rv.undo());
+        CHECK(same(rv, ref));
+    }
+
+    // back_insert_chunks() drains a producer a span at a time, stopping at max_n or when
+    // the producer runs dry
+    void back_insert_chunks_drains_a_source()
+    {
+        std::vector<int> source(1000);
+        for (std::size_t i = 0; i < source.size(); ++i)
+        {
+            source[i] = static_cast<int>(i);
+        }
+
+        rvec::rope_vector<int, 64> rv;
+        std::size_t read = 0;
+        auto reader = [&source, &read](int* data, std::size_t room)
+        {
+            // short reads, as a socket would give
+            std::size_t n = std::min({ room, std::size_t(50), source.size() - read });
+            std::copy(source.begin() + static_cast<std::ptrdiff_t>(read), source.begin() + static_cast<std::ptrdiff_t>(read + n), data);
+            read += n;
+            return n;
+        };
+
+        CHECK(rvec::back_insert_chunks(rv, reader, 333) == 333);
+        CHECK(same(rv, std::vector<int>(source.begin(), source.begin() + 333)));
+        CHECK(rvec::back_insert_chunks(rv, reader) == source.size() - 333);
+        CHECK(same(rv, source));
+        CHECK(rvec::back_insert_chunks(rv, reader) == 0);
+        CHECK(rv.size() == source.size());
+    }
+
+    // push_back runs interleaved with every edit that reshapes the tree, so the cached tail
+    // branch is used right after each kind of change
+    void push_back_follows_every_reshape()
+    {
+        using strings = rvec::rope_vector<std::string, 8>;
+
+        // an element of the container appended to it while its chunk has a gap at the front,
+        // which the append closes
+        {
+            rvec::rope_vector<std::string, 16> gapped;
+            for (int i = 0; i < 10; ++i)
+            {
+                gapped.push_back("element number " + std::to_string(i));
+            }
+            gapped.erase(0);
+            gapped.push_back(gapped[4]);
+            CHECK(gapped.size() == 10 && gapped.back() == "element number 5");
+        }
+
+        std::mt19937 rng(25);
+        strings rv;
+        std::vector<std::string> ref;
+        for (int step = 0; step < 3000; ++step)
+        {
+            unsigned op = rng() % 13;
+            std::size_t pos = rng() % (ref.size() + 1);
+            if (op == 0)
+            {
+                rv.insert(pos, "ins");
+                ref.insert(ref.begin() + static_cast<std::ptrdiff_t>(pos), "ins");
+            }
+            else if (op == 1 && !ref.empty())
+            {
+                std::size_t last = std::min(ref.size(), pos + rng() % 20);
+                rv.erase(pos, last);
+                ref.erase(ref.begin() + static_cast<std::ptrdiff_t>(pos), ref.begin() + static_cast<std::ptrdiff_t>(last));
+            }
+            else if (op == 2 && !ref.empty())
+            {
+                rv.erase_front();
+                ref.erase(ref.begin());
+            }
+            else if (op == 3)
+            {
+                strings tail = rv.split_off(pos);
+                tail.push_back("tail");
+                std::vector<std::string> moved(ref.begin() + static_cast<std::ptrdiff_t>(pos), ref.end());
+                moved.push_back("tail");
+                ref.resize(pos);
+                rv.push_back("split");
+                ref.push_back("split");
+                CHECK(same(tail, moved));
+                rv.append(std::move(tail));
+                ref.insert(ref.end(), moved.begin(), moved.end());
+            }
+            else if (op == 4)
+            {
+                strings other;
+                for (int i = 0; i < 5; ++i)
+                {
+                    other.push_back("s" + std::to_string(i));
+                    ref.insert(ref.begin() + static_cast<std::ptrdiff_t>(pos) + i, "s" + std::to_string(i));
+                }
+                rv.splice(pos, std::move(other));
+            }
+            else if (op == 5)
+            {
+                rv.shrink_to_fit();
+            }
+            else if (op == 6)
+            {
+                // the copy shares the tail chunk, so its appends must not reach rv
+                strings copy = rv;
+                copy.push_back("copy");
+                CHECK(copy.size() == ref.size() + 1 && copy.back() == "copy");
+                if (rng() % 2 == 0)
+                {
+                    rv = std::move(copy);
+                    ref.push_back("copy");
+                }
+            }
+            else if (op == 7)
+            {
+                strings other;
+                other.push_back("swapped");
+                rv.swap(other);
+                rv.push_back("after");
+                CHECK(same(rv, std::vector<std::string>{ "swapped", "after" }));
+                rv.swap(other);
+                rv.push_back("back");
+                ref.push_back("back");
+            }
+            else if (op == 8 && ref.size() > 200)
+            {
+                rv.clear();
+                ref.clear();
+            }
+            else if (op == 9)
+            {
+                std::size_t n = rng() % (ref.size() + 10);
+                rv.resize(n);
+                ref.resize(n);
+            }
+            else if (op == 10)
+            {
+                std::vector<std::string> values(rng() % 30, "n");
+                rv.append_n(values.data(), values.size());
+                ref.insert(ref.end(), values.begin(), values.end());
+            }
+            else if (op == 11 && !ref.empty())
+            {
+                // an argument that refers into the container itself
+                std::size_t i = rng() % ref.size();
+                rv.push_back(rv[i]);
+                ref.push_back(ref[i]);
+            }
+            else
+            {
+                rv.begin_group();
+                rv.push_back("grouped");
+                rv.end_group();
+                rv.undo();
+                rv.push_back("undone");
+                ref.push_back("undone");
+            }
+
+            for (unsigned i = 0, n = rng() % 20; i < n; ++i)
+            {
+                rv.push_back(std::to_string(step));
+                ref.push_back(std::to_string(step));
+            }
+            CHECK(rv.size() == ref.size());
+            CHECK(ref.empty() || rv[ref.size() - 1] == ref.back());
+            if (step % 50 == 0)
+            {
+                CHECK(same(rv, ref));
+            }
+        }
+        CHECK(same(rv, ref));
+    }
+
+    // append_n copies whole chunks at a time, for trivially copyable and other elements
+    void append_n_matches_push_back()
+    {
+        std::vector<int> ints(10000);
+        for (std::size_t i = 0; i < ints.size(); ++i)
+        {
+            ints[i] = static_cast<int>(i * 7);
+        }
+        rvec::rope_vector<int, 64> rv;
+        rv.push_back(-1);
+        std::vector<int> ref{ -1 };
+        for (std::size_t n : { std::size_t(0), std::size_t(1), std::size_t(63), std::size_t(64), std::size_t(1000), std::size_t(8872) })
+        {
+            rv.append_n(ints.data(), n);
+            ref.insert(ref.end(), ints.begin(), ints.begin() + static_cast<std::ptrdiff_t>(n));
+            CHECK(same(rv, ref));
+        }
+
+        std::vector<std::string> words(300);
+        for (std::size_t i = 0; i < words.size(); ++i)
+        {
+            words[i] = "word " + std::to_string(i);
+        }
+        rvec::rope_vector<std::string, 16> text;
+        text.append_n(words.data(), 5);
+        text.append_n(words.data() + 5, words.size() - 5);
+        CHECK(same(text, words));
+    }
+} // namespace
+
+int main()
+{
+    counted_tree_matches_model();
+    middle_insert_keeps_neighbours();
+    editing_gap_follows_the_cursor();
+    front_growth_and_fifo();
+    elements_live_only_while_stored();
+    trivially_copyable_paths_match_model();
+    allocator_owns_every_block();
+    spare_chunks_are_recycled();
+    iterators_agree_with_indices();
+    splice_append_and_split();
+    restructuring_survives_allocation_failure();
+    copies_share_until_written();
+    unshare_takes_private_chunks();
+    copies_cross_threads();
+    undo_redo_match_model();
+    history_rules();
+    large_paste_undoes();
+    batched_edits_match_model();
+    batched_edits_touch_only_their_chunks();
+    range_edits_match_model();
+    inserts_are_all_or_nothing();
+    erase_moves_the_shorter_side();
+    erases_near_chunk_ends_match_model();
+    append_spans_commit_in_place();
+    back_insert_chunks_drains_a_source();
+    push_back_follows_every_reshape();
+    append_n_matches_push_back();
+    return rvec_test::report();
+}
@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+#include "rvec/simd.hpp"
+
+#include "check.hpp"
+
+namespace
+{
+    // fills rv and ref with n values of pattern(i), then erases a few from the front so the
+    // runs no longer start at a vector boundary
+    template <typename T, std::size_t ChunkSize, typename Pattern>
+    void build(rvec::rope_vector<T, ChunkSize>& rv, std::vector<T>& ref, std::size_t n, Pattern pattern)
+    {
+        for (std::size_t i = 0; i < n + 3; ++i)
+        {
+            rv.push_back(pattern(i));
+            ref.push_back(pattern(i));
+        }
+        for (int i = 0; i < 3; ++i)
+        {
+            rv.erase_front();
+            ref.erase(ref.begin());
+        }
+    }
+
+    template <typename T, std::size_t ChunkSize>
+    void reductions_match_scalar(std::size_t n)
+    {
+        rvec::rope_vector<T, ChunkSize> rv;
+        std::vector<T> ref;
+        build(rv, ref, n, [](std::size_t i) { return static_cast<T>((i * 7919) % 97); });
+
+        CHECK(rvec::simd::sum(rv) == std::accumulate(ref.begin(), ref.end(), T()));
+        CHECK(rvec::simd::min(rv) == *std::min_element(ref.begin(), ref.end()));
+        CHECK(rvec::simd::max(rv) == *std::max_element(ref.begin(), ref.end()));
+        CHECK(rvec::simd::count(rv, T(5)) == static_cast<std::size_t>(std::count(ref.begin(), ref.end(), T(5))));
+        CHECK(rvec::simd::find(rv, T(96)) == static_cast<std::size_t>(std::find(ref.begin(), ref.end(), T(96)) - ref.begin()));
+        CHECK(rvec::simd::find(rv, T(100)) == rv.size());
+    }
+
+    // nearly every element matches, so with any vector width a full chunk hits each lane
+    // of a narrow element type more often than the lane's own counter can hold
+    template <typename T, std::size_t ChunkSize>
+    void narrow_count_does_not_wrap()
+    {
+        rvec::rope_vector<T, ChunkSize> rv;
+        std::vector<T> ref;
+        build(rv, ref, 3 * ChunkSize + 11, [](std::size_t i) { return static_cast<T>(i % 4096 == 5 ? 1 : 0); });
+        CHECK(rvec::simd::count(rv, T(0)) == static_cast<std::size_t>(std::count(ref.begin(), ref.end(), T(0))));
+        CHECK(rvec::simd::count(rv, T(1)) == static_cast<std::size_t>(std::count(ref.begin(), ref.end(), T(1))));
+    }
+
+    // the operands have different chunk sizes and front offsets, so their seams never line
+    // up; out aliasing an operand is allowed
+    void cross_container_kernels_match_scalar()
+    {
+        rvec::rope_vector<double, 64> a;
+        rvec::rope_vector<double, 100> b;
+        std::vector<double> ra;
+        std::vector<double> rb;
+        build(a, ra, 1000, [](std::size_t i) { return static_cast<double>(i % 17); });
+        build(b, rb, 1000, [](std::size_t i) { return static_cast<double>((i * 3) % 11); });
+        b.erase_front();
+        rb.erase(rb.begin());
+        b.push_back(4.0);
+        rb.push_back(4.0);
+
+        double dot = 0;
+        for (std::size_t i = 0; i < ra.size(); ++i)
+        {
+            dot += ra[i] * rb[i];
+        }
+        CHECK(rvec::simd::dot(a, b) == dot);
+
+        rvec::rope_vector<double, 32> out;
+        rvec::simd::add(out, a, b);
+        bool agree = out.size() == ra.size();
+        for (std::size_t i = 0; agree && i < ra.size(); ++i)
+        {
+            agree = out[i] == ra[i] + rb[i];
+        }
+        CHECK(agree);
+
+        rvec::simd::subtract(out, out, b);
+        agree = out.size() == ra.size();
+        for (std::size_t i = 0; agree && i < ra.size(); ++i)
+        {
+            agree = out[i] == ra[i];
+        }
+        CHECK(agree);
+
+        rvec::simd::multiply(a, a, b);
+        rvec::simd::axpy(2.0, b, a);
+        agree = true;
+        for (std::size_t i = 0; agree && i < ra.size(); ++i)
+        {
+            agree = a[i] == ra[i] * rb[i] + 2.0 * rb[i];
+        }
+        CHECK(agree);
+
+        rvec::rope_vector<std::uint8_t, 48> lt;
+        rvec::rope_vector<int, 48> eq;
+        rvec::simd::less(lt, out, b);
+        rvec::simd::equal(eq, out, b);
+        agree = lt.size() == ra.size() && eq.size() == ra.size();
+        for (std::size_t i = 0; agree && i < ra.size(); ++i)
+        {
+            agree = lt[i] == (ra[i] < rb[i] ? 1 : 0) && eq[i] == (ra[i] == rb[i] ? 1 : 0);
+        }
+        CHECK(agree);
+
+        // zip hands out pieces that are contiguous in every container at once
+        std::size_t seen = 0;
+        bool contiguous = true;
+        rvec::simd::zip([&](std::size_t n, double* x, const double* y)
+            {
+                contiguous = contiguous && &x[n - 1] == &out[seen + n - 1] && &y[n - 1] == &b[seen + n - 1];
+                seen += n;
+            },
+            out, static_cast<const rvec::rope_vector<double, 100>&>(b));
+        CHECK(contiguous);
+        CHECK(seen == ra.size());
+    }
+} // namespace
+
+int main()
+{
+    reductions_match_scalar<int, 256>(10000);
+    reductions_match_scalar<std::uint32_t, 64>(999);
+    reductions_match_scalar<std::int16_t, 128>(300);
+    reductions_match_scalar<double, 256>(4321);
+    reductions_match_scalar<float, 32>(77);
+    reductions_match_scalar<long double, 64>(500);
+    narrow_count_does_not_wrap<std::int8_t, 8192>();
+    narrow_count_does_not_wrap<std::uint8_t, 8192>();
+    narrow_count_does_not_wrap<std::int16_t, 1 << 20>();
+    cross_container_kernels_match_scalar();
+    return rvec_test::report();
+}
@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "rvec/sort.hpp"
+
+#include "check.hpp"
+
+using rvec_test::same;
+
+namespace
+{
+    struct record
+    {
+        int key;
+        int seq;
+
+        bool operator==(const record& other) const
+        {
+            return key == other.key && seq == other.seq;
+        }
+    };
+
+    void comparison_sorts_match_std()
+    {
+        rvec::par::thread_pool pool(4);
+        std::mt19937 rng(15);
+
+        rvec::rope_vector<std::string, 64> words;
+        std::vector<std::string> ref;
+        for (int i = 0; i < 20000; ++i)
+        {
+            std::string w = std::to_string(rng() % 5000);
+            words.push_back(w);
+            ref.push_back(w);
+        }
+        words.erase_front();
+        ref.erase(ref.begin());
+        rvec::sort(words, pool);
+        std::sort(ref.begin(), ref.end());
+        CHECK(same(words, ref));
+
+        rvec::sort(words, std::greater<std::string>(), pool);
+        std::sort(ref.begin(), ref.end(), std::greater<std::string>());
+        CHECK(same(words, ref));
+
+        // equal keys keep their input order
+        rvec::rope_vector<record, 128> records;
+        std::vector<record> ref_records;
+        for (int i = 0; i < 30000; ++i)
+        {
+            record r{ static_cast<int>(rng() % 100), i };
+            records.push_back(r);
+            ref_records.push_back(r);
+        }
+        auto by_key = [](const record& a, const record& b) { return a.key < b.key; };
+        rvec::stable_sort(records, by_key, pool);
+        std::stable_sort(ref_records.begin(), ref_records.end(), by_key);
+        CHECK(same(records, ref_records));
+    }
+
+    template <typename T>
+    void radix_sort_matches_std(std::size_t n)
+    {
+        std::mt19937_64 rng(n);
+        rvec::rope_vector<T, 256> rv;
+        std::vector<T> ref;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            T v = static_cast<T>(rng());
+            rv.push_back(v);
+            ref.push_back(v);
+        }
+        rvec::radix_sort(rv);
+        std::sort(ref.begin(), ref.end());
+        CHECK(same(rv, ref));
+    }
+
+    std::uint64_t bits(double d)
+    {
+        std::uint64_t b;
+        std::memcpy(&b, &d, sizeof b);
+        return b;
+    }
+
+    // floating-point keys are ordered by their radix image in every round, merges included:
+    // -0.0 before 0.0, negative NaNs before -inf and positive NaNs after inf
+    void radix_sort_orders_floats_by_key()
+    {
+        rvec::par::thread_pool pool(4);
+        const double values[] = { 1.5, -0.0, 0.0, -2.25, INFINITY, -INFINITY, std::nan(""), -std::nan(""), 3.0, -7.0 };
+        rvec::rope_vector<double, 64> rv;
+        for (int i = 0; i < 20000; ++i)
+        {
+            rv.push_back(values[(i * 7) % 10]);
+        }
+        rvec::radix_sort(rv, pool);
+
+        bool ordered = true;
+        using key = rvec::par::detail::radix_key<double>;
+        for (std::size_t i = 1; i < rv.size(); ++i)
+        {
+            ordered = ordered && key::get(rv[i - 1]) <= key::get(rv[i]);
+        }
+        CHECK(ordered);
+        CHECK(std::isnan(rv.front()) && std::signbit(rv.front()));
+        CHECK(std::isnan(rv.back()) && !std::signbit(rv.back()));
+
+        std::size_t first_zero = 0;
+        while (rv[first_zero] != 0.0)
+        {
+            ++first_zero;
+        }
+        CHECK(bits(rv[first_zero]) == bits(-0.0));
+        CHECK(bits(rv[first_zero + 2000]) == bits(0.0));
+        CHECK(bits(rv[first_zero + 1999]) == bits(-0.0));
+    }
+
+    // too wide for the radix keys, long double falls back to the comparison sort
+    void long_double_takes_the_comparison_sort()
+    {
+        rvec::rope_vector<long double, 64> rv;
+        std::vector<long double> ref;
+        for (int i = 0; i < 3000; ++i)
+        {
+            long double v = static_cast<long double>((i * 7919) % 3001) / 7;
+            rv.push_back(v);
+            ref.push_back(v);
+        }
+        rvec::sort(rv);
+        std::sort(ref.begin(), ref.end());
+        CHECK(same(rv, ref));
+    }
+
+    template <std::size_t ChunkSize>
+    rvec::rope_vector<record, ChunkSize> sorted_run(int n, int tag, unsigned seed)
+    {
+        std::mt19937 rng(seed);
+        std::vector<record> values;
+        for (int i = 0; i < n; ++i)
+        {
+            values.push_back(record{ static_cast<int>(rng() % 1000), tag * 1000000 + i });
+        }
+        std::stable_sort(values.begin(), values.end(), [](const record& a, const record& b) { return a.key < b.key; });
+        rvec::rope_vector<record, ChunkSize> rv;
+        for (const record& r : values)
+        {
+            rv.push_back(r);
+        }
+        return rv;
+    }
+
+    // merges are stable with ties going to the earlier input, whatever the inputs' seams
+    void merges_match_std()
+    {
+        rvec::par::thread_pool pool(4);
+        auto by_key = [](const record& a, const record& b) { return a.key < b.key; };
+
+        rvec::rope_vector<record, 64> a = sorted_run<64>(7000, 1, 1);
+        rvec::rope_vector<record, 100> b = sorted_run<100>(5000, 2, 2);
+        std::vector<record> ref;
+        std::merge(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(ref), by_key);
+        rvec::rope_vector<record, 64> out;
+        rvec::merge(a, b, out, by_key, pool);
+        CHECK(same(out, ref));
+
+        // [0, mid) and [mid, size()) of one container
+        rvec::rope_vector<record, 64> both = a;
+        std::size_t mid = both.size();
+        for (const record& r : b)
+        {
+            both.push_back(r);
+        }
+        rvec::inplace_merge(both, mid, by_key, pool);
+        CHECK(same(both, ref));
+
+        std::vector<rvec::rope_vector<record, 64>> runs;
+        std::vector<record> all;
+        for (int k = 0; k < 5; ++k)
+        {
+            runs.push_back(sorted_run<64>(1000 + 300 * k, k, 10 + k));
+            std::vector<record> merged;
+            std::merge(all.begin(), all.end(), runs.back().begin(), runs.back().end(), std::back_inserter(merged), by_key);
+            all.swap(merged);
+        }
+        rvec::merge_all(runs.begin(), runs.end(), out, by_key, pool);
+        CHECK(same(out, all));
+
+        rvec::merge_all(runs.begin(), runs.begin(), out, by_key, pool);
+        CHECK(out.empty());
+
+        // a lone input is copied out without unsharing it from its copies
+        rvec::rope_vector<record, 64> snapshot = runs[0];
+        rvec::merge_all(runs.begin(), runs.begin() + 1, out, by_key, pool);
+        CHECK(same(out, snapshot));
+        CHECK(&*snapshot.cbegin() == &*runs[0].cbegin());
+    }
+
+    // inplace_merge inside an undo group is one step: undo brings back the two unmerged runs
+    void inplace_merge_is_undoable()
+    {
+        rvec::par::thread_pool pool(4);
+        auto by_key = [](const record& a, const record& b) { return a.key < b.key; };
+        rvec::rope_vector<record, 64> rv = sorted_run<64>(3000, 1, 3);
+        std::size_t mid = rv.size();
+        for (const record& r : sorted_run<64>(2000, 2, 4))
+        {
+            rv.push_back(r);
+        }
+        std::vector<record> unmerged(rv.begin(), rv.end());
+        std::vector<record> merged;
+        std::merge(unmerged.begin(), unmerged.begin() + static_cast<std::ptrdiff_t>(mid), unmerged.begin() + static_cast<std::ptrdiff_t>(mid), unmerged.end(), std::back_inserter(merged), by_key);
+
+        rv.begin_group();
+        rvec::inplace_merge(rv, mid, by_key, pool);
+        rv.end_group();
+        CHECK(same(rv, merged));
+        CHECK(rv.undo());
+        CHECK(same(rv, unmerged));
+        CHECK(rv.redo());
+        CHECK(same(rv, merged));
+    }
+} // namespace
+
+int main()
+{
+    comparison_sorts_match_std();
+    radix_sort_matches_std<int>(50000);
+    radix_sort_matches_std<std::int64_t>(20000);
+    radix_sort_matches_std<std::uint8_t>(10000);
+    radix_sort_matches_std<std::int16_t>(7777);
+    radix_sort_orders_floats_by_key();
+    long_double_takes_the_comparison_sort();
+    merges_match_std();
+    inplace_merge_is_undoable();
+    return rvec_test::report();
+}